@@ -0,0 +1,144 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements a small benchmark that compares the RestApiOutV1::Base64 encoder and decoder against
+* QByteArray::toBase64 and QByteArray::fromBase64.
+***********************************************************************************************************************/
+
+#include <QByteArray>
+#include <QElapsedTimer>
+
+#include <cstdio>
+#include <functional>
+
+#include <rest_api_out_v1_base64.h>
+
+/**
+ * Minimum time to spend measuring each case, in nanoseconds.
+ */
+static const long long minimumMeasurementTime = 200000000LL;
+
+/**
+ * Input sizes to measure, in bytes.  The list is terminated with a zero entry.
+ */
+static const int inputSizes[] = { 64, 1024, 65536, 1048576, 0 };
+
+/**
+ * Value updated from every measured result so the compiler can not discard the work being measured.
+ */
+static volatile unsigned long sink = 0;
+
+/**
+ * Method that repeatedly runs an operation and reports the throughput.
+ *
+ * \param[in] numberBytes The number of input bytes processed by a single call to the operation.
+ *
+ * \param[in] operation   The operation to measure.
+ *
+ * \return Returns the measured throughput, in GB/s of input.
+ */
+static double measure(int numberBytes, const std::function<void()>& operation) {
+    unsigned long long iterations = 0;
+    QElapsedTimer      timer;
+
+    operation();
+    timer.start();
+
+    long long elapsed;
+    do {
+        operation();
+        ++iterations;
+        elapsed = timer.nsecsElapsed();
+    } while (elapsed < minimumMeasurementTime);
+
+    return static_cast<double>(iterations) * numberBytes / static_cast<double>(elapsed);
+}
+
+
+/**
+ * Function that returns a printable name for a Base64 implementation.
+ *
+ * \param[in] implementation The implementation to name.
+ *
+ * \return Returns the implementation name.
+ */
+static const char* implementationName(RestApiOutV1::Base64::Implementation implementation) {
+    switch (implementation) {
+        case RestApiOutV1::Base64::Implementation::SCALAR: { return "scalar"; }
+        case RestApiOutV1::Base64::Implementation::SSSE3:  { return "SSSE3";  }
+        case RestApiOutV1::Base64::Implementation::AVX2:   { return "AVX2";   }
+    }
+
+    return "unknown";
+}
+
+
+int main(int, char**) {
+    std::printf("Base64 implementation: %s\n\n", implementationName(RestApiOutV1::Base64::implementation()));
+    std::printf(
+        "%10s %15s %15s %15s %15s\n",
+        "bytes",
+        "encode GB/s",
+        "toBase64 GB/s",
+        "decode GB/s",
+        "fromBase64 GB/s"
+    );
+
+    for (const int* size=inputSizes ; *size != 0 ; ++size) {
+        QByteArray data(*size, Qt::Uninitialized);
+        for (int i=0 ; i<*size ; ++i) {
+            data[i] = static_cast<char>((i * 131) ^ (i >> 7));
+        }
+
+        QByteArray encoded = data.toBase64();
+        bool       ok      = false;
+        QByteArray decoded = RestApiOutV1::Base64::decode(encoded, &ok);
+        if (RestApiOutV1::Base64::encode(data) != encoded || decoded != data || !ok) {
+            std::fprintf(stderr, "Base64 round trip mismatch for %d bytes.\n", *size);
+            return 1;
+        }
+
+        double encodeRate = measure(*size, [&data]() {
+            sink = sink + static_cast<unsigned long>(RestApiOutV1::Base64::encode(data).size());
+        });
+
+        double toBase64Rate = measure(*size, [&data]() {
+            sink = sink + static_cast<unsigned long>(data.toBase64().size());
+        });
+
+        double decodeRate = measure(*size, [&encoded]() {
+            sink = sink + static_cast<unsigned long>(RestApiOutV1::Base64::decode(encoded).size());
+        });
+
+        double fromBase64Rate = measure(*size, [&encoded]() {
+            sink = sink + static_cast<unsigned long>(QByteArray::fromBase64(encoded).size());
+        });
+
+        std::printf(
+            "%10d %15.3f %15.3f %15.3f %15.3f\n",
+            *size,
+            encodeRate,
+            toBase64Rate,
+            decodeRate,
+            fromBase64Rate
+        );
+    }
+
+    return 0;
+}
@@ -0,0 +1,144 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref RestApiOutV1::Base64 class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project inerest_api_out_v1 */
+
+#ifndef REST_API_OUT_V1_BASE64_H
+#define REST_API_OUT_V1_BASE64_H
+
+#include <QByteArray>
+
+#include "rest_api_out_v1_common.h"
+
+namespace RestApiOutV1 {
+    /**
+     * Base64 encoder and decoder using the standard alphabet with padding, as described in RFC 4648.  On x86
+     * processors, AVX2 or SSSE3 code is selected at run time when the processor supports it.  Other processors use a
+     * portable implementation.
+     *
+     * Unlike QByteArray::fromBase64, the decoder is strict.  Characters outside the alphabet, including whitespace,
+     * cause decoding to fail.  Padding is optional.
+     */
+    class REST_API_OUT_V1_PUBLIC_API Base64 {
+        public:
+            /**
+             * Enumeration of available implementations.
+             */
+            enum class Implementation {
+                /**
+                 * Portable implementation.
+                 */
+                SCALAR,
+
+                /**
+                 * Implementation using SSSE3 instructions.
+                 */
+                SSSE3,
+
+                /**
+                 * Implementation using AVX2 instructions.
+                 */
+                AVX2
+            };
+
+            /**
+             * Method you can use to determine which implementation is in use.
+             *
+             * \return Returns the implementation selected for this processor.
+             */
+            static Implementation implementation();
+
+            /**
+             * Method you can use to calculate the length of the encoding of a block of data.
+             *
+             * \param[in] length The length of the data, in bytes.
+             *
+             * \return Returns the length of the encoded data, including padding.
+             */
+            static inline unsigned long encodedLength(unsigned long length) {
+                return 4 * ((length + 2) / 3);
+            }
+
+            /**
+             * Method you can use to calculate the largest possible length of decoded data.
+             *
+             * \param[in] length The length of the encoded data, in bytes.
+             *
+             * \return Returns an upper bound on the length of the decoded data.
+             */
+            static inline unsigned long maximumDecodedLength(unsigned long length) {
+                return 3 * ((length + 3) / 4);
+            }
+
+            /**
+             * Method you can use to encode a block of data into a caller supplied buffer.
+             *
+             * \param[in] data        The data to be encoded.
+             *
+             * \param[in] length      The length of the data, in bytes.
+             *
+             * \param[in] destination Buffer to receive the encoded data.  The buffer must hold
+             *                        \ref encodedLength bytes.
+             *
+             * \return Returns a pointer just past the encoded data.
+             */
+            static char* encode(const char* data, unsigned long length, char* destination);
+
+            /**
+             * Method you can use to encode a block of data.
+             *
+             * \param[in] data The data to be encoded.
+             *
+             * \return Returns the encoded data.
+             */
+            static QByteArray encode(const QByteArray& data);
+
+            /**
+             * Method you can use to decode a block of data into a caller supplied buffer.
+             *
+             * \param[in] data        The data to be decoded.
+             *
+             * \param[in] length      The length of the data, in bytes.
+             *
+             * \param[in] destination Buffer to receive the decoded data.  The buffer must hold
+             *                        \ref maximumDecodedLength bytes.
+             *
+             * \return Returns the length of the decoded data.  A negative value is returned if the data is not valid
+             *         base64.
+             */
+            static long decode(const char* data, unsigned long length, char* destination);
+
+            /**
+             * Method you can use to decode a block of data.
+             *
+             * \param[in]  data The data to be decoded.
+             *
+             * \param[out] ok   Optional pointer to a flag set to true on success or false if the data is not valid
+             *                  base64.
+             *
+             * \return Returns the decoded data.  An empty array is returned if the data is not valid base64.
+             */
+            static QByteArray decode(const QByteArray& data, bool* ok = nullptr);
+    };
+}
+
+#endif
@@ -0,0 +1,174 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref RestApiOutV1::HmacSha256 class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project inerest_api_out_v1 */
+
+#ifndef REST_API_OUT_V1_HMAC_SHA256_H
+#define REST_API_OUT_V1_HMAC_SHA256_H
+
+#include <QByteArray>
+
+#include <cstdint>
+
+#include "rest_api_out_v1_common.h"
+
+namespace RestApiOutV1 {
+    /**
+     * HMAC-SHA256 signer that retains the hash states left after processing the inner and outer padded keys.  Once
+     * a key is set, each signature only hashes the message, which makes repeated signing of small messages with the
+     * same key roughly twice as fast as building a new HMAC instance each time.
+     *
+     * The retained states are equivalent to the key and are cleared when the instance is destroyed or a new key is
+     * set.
+     */
+    class REST_API_OUT_V1_PUBLIC_API HmacSha256 {
+        public:
+            /**
+             * The SHA-256 block size, in bytes.
+             */
+            static const unsigned blockSize;
+
+            /**
+             * The size of generated digests, in bytes.
+             */
+            static const unsigned digestSize;
+
+            HmacSha256();
+
+            /**
+             * Constructor
+             *
+             * \param[in] key The key to be used.
+             */
+            HmacSha256(const QByteArray& key);
+
+            /**
+             * Copy constructor
+             *
+             * \param[in] other The instance to be copied.
+             */
+            HmacSha256(const HmacSha256& other);
+
+            ~HmacSha256();
+
+            /**
+             * Method you can use to set the key.
+             *
+             * \param[in] key       Pointer to the key.
+             *
+             * \param[in] keyLength The key length, in bytes.  Keys longer than \ref blockSize are hashed first, as
+             *                      required by RFC 2104.
+             */
+            void setKey(const char* key, unsigned long keyLength);
+
+            /**
+             * Method you can use to set the key.
+             *
+             * \param[in] key The key to be used.
+             */
+            inline void setKey(const QByteArray& key) {
+                setKey(key.constData(), static_cast<unsigned long>(key.size()));
+            }
+
+            /**
+             * Method you can use to calculate the digest of a message.
+             *
+             * \param[in]  message       Pointer to the message.
+             *
+             * \param[in]  messageLength The message length, in bytes.
+             *
+             * \param[out] digest        Buffer to receive the digest.  The buffer must hold \ref digestSize bytes.
+             */
+            void digest(const char* message, unsigned long long messageLength, char* digest) const;
+
+            /**
+             * Method you can use to calculate the digest of a message.
+             *
+             * \param[in] message The message.
+             *
+             * \return Returns the digest.
+             */
+            QByteArray digest(const QByteArray& message) const;
+
+            /**
+             * Assignment operator.
+             *
+             * \param[in] other The instance to be copied.
+             *
+             * \return Returns a reference to this instance.
+             */
+            HmacSha256& operator=(const HmacSha256& other);
+
+        private:
+            /**
+             * The number of 32-bit words in the SHA-256 state.
+             */
+            static constexpr unsigned stateWords = 8;
+
+            /**
+             * Method that processes one block.
+             *
+             * \param[in,out] state The hash state to be updated.
+             *
+             * \param[in]     block The block to be processed.  The block must hold \ref blockSize bytes.
+             */
+            static void compress(std::uint32_t* state, const std::uint8_t* block);
+
+            /**
+             * Method that hashes a message starting from an existing state and writes the final hash.
+             *
+             * \param[in,out] state         The hash state.  The state is left undefined on exit.
+             *
+             * \param[in]     prefixLength  The number of bytes already processed into the state.
+             *
+             * \param[in]     message       The message.
+             *
+             * \param[in]     messageLength The message length, in bytes.
+             *
+             * \param[out]    digest        Buffer to receive the hash.
+             */
+            static void finish(
+                std::uint32_t*       state,
+                unsigned long long   prefixLength,
+                const std::uint8_t*  message,
+                unsigned long long   messageLength,
+                std::uint8_t*        digest
+            );
+
+            /**
+             * Method that clears the retained states.
+             */
+            void clear();
+
+            /**
+             * The hash state after processing the inner padded key.
+             */
+            std::uint32_t innerState[stateWords];
+
+            /**
+             * The hash state after processing the outer padded key.
+             */
+            std::uint32_t outerState[stateWords];
+    };
+}
+
+#endif
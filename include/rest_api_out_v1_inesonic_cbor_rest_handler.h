@@ -0,0 +1,408 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref RestApiOutV1::InesonicCborRestHandler class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project inerest_api_out_v1 */
+
+#ifndef REST_API_OUT_V1_INESONIC_CBOR_REST_HANDLER_H
+#define REST_API_OUT_V1_INESONIC_CBOR_REST_HANDLER_H
+
+#include <QObject>
+#include <QString>
+#include <QHash>
+
+#include <cstdint>
+#include <functional>
+
+#include "rest_api_out_v1_common.h"
+#include "rest_api_out_v1_inesonic_rest_handler_base.h"
+
+class QCborMap;
+class QCborValue;
+class QCborArray;
+class QNetworkReply;
+
+namespace RestApiOutV1 {
+    /**
+     * Inesonic REST API handler for CBOR data.  Each message is a CBOR map holding the payload and the hash as the
+     * "data" and "hash" byte strings, sent with the content type application/cbor.  Responses are decoded as CBOR.
+     */
+    class REST_API_OUT_V1_PUBLIC_API InesonicCborRestHandler:public QObject, public InesonicRestHandlerBase {
+        Q_OBJECT
+
+        public:
+            /**
+             * Type used for callbacks that receive a response.  The callback receives the request ID and the CBOR
+             * response data.
+             */
+            typedef std::function<void(unsigned long long, const QCborValue&)> ResponseCallback;
+
+            /**
+             * Type used for callbacks that receive a failure.  The callback receives the request ID and a string
+             * describing the failure.
+             */
+            typedef std::function<void(unsigned long long, const QString&)> FailureCallback;
+
+            /**
+             * Constructor
+             *
+             * \param[in] server The server instance this REST API will talk to.
+             *
+             * \param[in] parent Pointer to the parent object.
+             */
+            InesonicCborRestHandler(Server* server, QObject* parent = nullptr);
+
+            /**
+             * Constructor
+             *
+             * \param[in] secret The secret to be used by this REST API.
+             *
+             * \param[in] server The server instance this REST API will talk to.
+             *
+             * \param[in] parent Pointer to the parent object.
+             */
+            InesonicCborRestHandler(const QByteArray& secret, Server* server, QObject* parent = nullptr);
+
+            ~InesonicCborRestHandler() override;
+
+            /**
+             * Method you can use to send a message to a remote server, with the result delivered to callbacks
+             * rather than through the \ref cborResponse and \ref requestFailed signals.  Callbacks are invoked
+             * directly from the thread this handler lives in.
+             *
+             * \param[in] endpoint         The endpoint to send the message to.
+             *
+             * \param[in] cborData         The CBOR payload to be send.
+             *
+             * \param[in] responseCallback The callback to invoke when a response is received.
+             *
+             * \param[in] failureCallback  The callback to invoke if the request fails.  If empty, failures are
+             *                             reported through the \ref requestFailed signal.
+             *
+             * \return Returns an ID identifying this request.
+             */
+            unsigned long long post(
+                const QString&          endpoint,
+                const QCborValue&    cborData,
+                const ResponseCallback& responseCallback,
+                const FailureCallback&  failureCallback = FailureCallback()
+            );
+
+            /**
+             * Method you can use to send a message to a remote server, with the result delivered to callbacks
+             * rather than through the \ref cborResponse and \ref requestFailed signals.  Callbacks are invoked
+             * directly from the thread this handler lives in.
+             *
+             * \param[in] endpoint         The endpoint to send the message to.
+             *
+             * \param[in] cborData         The CBOR payload to be send.
+             *
+             * \param[in] responseCallback The callback to invoke when a response is received.
+             *
+             * \param[in] failureCallback  The callback to invoke if the request fails.  If empty, failures are
+             *                             reported through the \ref requestFailed signal.
+             *
+             * \return Returns an ID identifying this request.
+             */
+            unsigned long long post(
+                const QString&          endpoint,
+                const QCborMap&         cborData,
+                const ResponseCallback& responseCallback,
+                const FailureCallback&  failureCallback = FailureCallback()
+            );
+
+            /**
+             * Method you can use to send a message to a remote server, with the result delivered to callbacks
+             * rather than through the \ref cborResponse and \ref requestFailed signals.  Callbacks are invoked
+             * directly from the thread this handler lives in.
+             *
+             * \param[in] endpoint         The endpoint to send the message to.
+             *
+             * \param[in] cborData         The CBOR payload to be send.
+             *
+             * \param[in] responseCallback The callback to invoke when a response is received.
+             *
+             * \param[in] failureCallback  The callback to invoke if the request fails.  If empty, failures are
+             *                             reported through the \ref requestFailed signal.
+             *
+             * \return Returns an ID identifying this request.
+             */
+            unsigned long long post(
+                const QString&          endpoint,
+                const QCborArray&       cborData,
+                const ResponseCallback& responseCallback,
+                const FailureCallback&  failureCallback = FailureCallback()
+            );
+
+            /**
+             * Method you can use to send a message to a remote server from any thread.  The payload is serialized on
+             * the calling thread and the request is started on the thread of the server this handler was
+             * constructed with.  This handler must live on that thread and must outlive the request.
+             *
+             * \param[in] endpoint         The endpoint to send the message to.
+             *
+             * \param[in] cborData         The CBOR payload to be send.
+             *
+             * \param[in] responseCallback The callback to invoke when a response is received.
+             *
+             * \param[in] failureCallback  The callback to invoke if the request fails.  If empty, failures are
+             *                             reported through the \ref requestFailed signal.
+             *
+             * \param[in] executor         The executor used to run the callbacks.  If empty, the callbacks are run on
+             *                             the server's thread.
+             */
+            void submit(
+                const QString&          endpoint,
+                const QCborValue&       cborData,
+                const ResponseCallback& responseCallback,
+                const FailureCallback&  failureCallback = FailureCallback(),
+                const Server::Executor& executor = Server::Executor()
+            );
+
+            /**
+             * Method you can use to send a message to a remote server from any thread.  The payload is serialized on
+             * the calling thread and the request is started on the thread of the server this handler was
+             * constructed with.  This handler must live on that thread and must outlive the request.
+             *
+             * \param[in] endpoint         The endpoint to send the message to.
+             *
+             * \param[in] cborData         The CBOR payload to be send.
+             *
+             * \param[in] responseCallback The callback to invoke when a response is received.
+             *
+             * \param[in] failureCallback  The callback to invoke if the request fails.  If empty, failures are
+             *                             reported through the \ref requestFailed signal.
+             *
+             * \param[in] executor         The executor used to run the callbacks.  If empty, the callbacks are run on
+             *                             the server's thread.
+             */
+            void submit(
+                const QString&          endpoint,
+                const QCborMap&         cborData,
+                const ResponseCallback& responseCallback,
+                const FailureCallback&  failureCallback = FailureCallback(),
+                const Server::Executor& executor = Server::Executor()
+            );
+
+            /**
+             * Method you can use to send a message to a remote server from any thread.  The payload is serialized on
+             * the calling thread and the request is started on the thread of the server this handler was
+             * constructed with.  This handler must live on that thread and must outlive the request.
+             *
+             * \param[in] endpoint         The endpoint to send the message to.
+             *
+             * \param[in] cborData         The CBOR payload to be send.
+             *
+             * \param[in] responseCallback The callback to invoke when a response is received.
+             *
+             * \param[in] failureCallback  The callback to invoke if the request fails.  If empty, failures are
+             *                             reported through the \ref requestFailed signal.
+             *
+             * \param[in] executor         The executor used to run the callbacks.  If empty, the callbacks are run on
+             *                             the server's thread.
+             */
+            void submit(
+                const QString&          endpoint,
+                const QCborArray&       cborData,
+                const ResponseCallback& responseCallback,
+                const FailureCallback&  failureCallback = FailureCallback(),
+                const Server::Executor& executor = Server::Executor()
+            );
+
+        public slots:
+            /**
+             * Slot you can use to send a message to a remote server.
+             *
+             * \param[in] endpoint The endpoint to send the message to.
+             *
+             * \param[in] cborData The CBOR payload to be send.
+             *
+             * \return Returns an ID identifying this request.  The ID is included in the \ref cborResponse and
+             *         \ref requestFailed signals.
+             */
+            unsigned long long post(const QString& endpoint, const QCborValue& cborData);
+
+            /**
+             * Slot you can use to send a message to a remote server.
+             *
+             * \param[in] endpoint The endpoint to send the message to.
+             *
+             * \param[in] cborData The CBOR payload to be send.
+             *
+             * \return Returns an ID identifying this request.  The ID is included in the \ref cborResponse and
+             *         \ref requestFailed signals.
+             */
+            unsigned long long post(const QString& endpoint, const QCborMap& cborData);
+
+            /**
+             * Slot you can use to send a message to a remote server.
+             *
+             * \param[in] endpoint The endpoint to send the message to.
+             *
+             * \param[in] cborData The CBOR payload to be send.
+             *
+             * \return Returns an ID identifying this request.  The ID is included in the \ref cborResponse and
+             *         \ref requestFailed signals.
+             */
+            unsigned long long post(const QString& endpoint, const QCborArray& cborData);
+
+        signals:
+            /**
+             * Signal that is emitted when a response to a request is received.
+             *
+             * \param[out] requestId The ID of the request.
+             *
+             * \param[out] cborData  The CBOR response data.
+             */
+            void cborResponse(unsigned long long requestId, const QCborValue& cborData);
+
+            /**
+             * Signal that is emitted when a request fails.
+             *
+             * \param[out] requestId   The ID of the request.
+             *
+             * \param[out] errorString a string providing an error message.
+             */
+            void requestFailed(unsigned long long requestId, const QString& errorString);
+
+        protected:
+            /**
+             * Method you can overload to process a received response.  The default implementation will trigger the
+             * \ref cborResponse signal.
+             *
+             * \param[in] requestId The ID of the request.
+             *
+             * \param[in] cborData  The received CBOR response.
+             */
+            virtual void processCborResponse(unsigned long long requestId, const QCborValue& cborData);
+
+            /**
+             * Method you can overload to process a failed transmisison attempt.  The default implementation will
+             * trigger the \ref requestFailed signal.
+             *
+             * \param[in] requestId   The ID of the request.
+             *
+             * \param[in] errorString a string providing an error message.
+             */
+            virtual void processRequestFailed(unsigned long long requestId, const QString& errorString);
+
+            /**
+             * Method that is called once per request to encode the payload.  The payload is placed in the message
+             * envelope, which is left open for the hash.
+             *
+             * \param[in] payload The request payload.
+             *
+             * \return Returns the leading portion of the message envelope.
+             */
+            QByteArray encodePayload(const QByteArray& payload) override;
+
+            /**
+             * Method that is called to build the message sent for a request.
+             *
+             * \param[in] encodedPayload The payload as returned by \ref encodePayload.
+             *
+             * \param[in] hash           The hash calculated for the payload.
+             *
+             * \return Returns the message to be sent.
+             */
+            QByteArray buildMessage(const QByteArray& encodedPayload, const QByteArray& hash) override;
+
+            /**
+             * Method that is called to determine the content type of sent messages.
+             *
+             * \return Returns the content type.
+             */
+            QString messageContentType() const override;
+
+            /**
+             * Method that is called when a request completes successfully.
+             *
+             * \param[in] requestId The ID of the completed request.
+             *
+             * \param[in] reply     The network reply holding the response.
+             */
+            void processReply(unsigned long long requestId, QNetworkReply* reply) override;
+
+            /**
+             * Method that is called when a request fails.
+             *
+             * \param[in] requestId   The ID of the failed request.
+             *
+             * \param[in] errorString A string describing the failure.
+             */
+            void processFailure(unsigned long long requestId, const QString& errorString) override;
+
+        private:
+            /**
+             * Method that starts a request for an already serialized payload.
+             *
+             * \param[in] endpoint The endpoint to send the message to.
+             *
+             * \param[in] payload  The serialized CBOR payload.
+             *
+             * \param[in] setup    Optional function used to register callbacks for the request.
+             *
+             * \return Returns an ID identifying this request.
+             */
+            unsigned long long postPayload(
+                const QString&      endpoint,
+                const QByteArray&   payload,
+                const RequestSetup& setup = RequestSetup()
+            );
+
+            /**
+             * Method that registers callbacks for a request.
+             *
+             * \param[in] requestId        The ID of the request.
+             *
+             * \param[in] responseCallback The callback to invoke when a response is received.
+             *
+             * \param[in] failureCallback  The callback to invoke if the request fails.
+             */
+            void registerCallbacks(
+                unsigned long long      requestId,
+                const ResponseCallback& responseCallback,
+                const FailureCallback&  failureCallback
+            );
+
+            /**
+             * Structure holding the callbacks for a request.
+             */
+            struct Callbacks {
+                /**
+                 * The callback to invoke when a response is received.
+                 */
+                ResponseCallback responseCallback;
+
+                /**
+                 * The callback to invoke if the request fails.
+                 */
+                FailureCallback failureCallback;
+            };
+
+            /**
+             * Hash table of callbacks for outstanding requests, by request ID.
+             */
+            QHash<unsigned long long, Callbacks> requestCallbacks;
+    };
+}
+
+#endif
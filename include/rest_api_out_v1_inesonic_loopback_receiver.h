@@ -0,0 +1,254 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref RestApiOutV1::InesonicLoopbackReceiver class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project inerest_api_out_v1 */
+
+#ifndef REST_API_OUT_V1_INESONIC_LOOPBACK_RECEIVER_H
+#define REST_API_OUT_V1_INESONIC_LOOPBACK_RECEIVER_H
+
+#include <QString>
+#include <QByteArray>
+#include <QHash>
+#include <QNetworkRequest>
+
+#include <functional>
+
+#include "rest_api_out_v1_common.h"
+#include "rest_api_out_v1_loopback_transport.h"
+
+namespace RestApiOutV1 {
+    /**
+     * Receiver for the \ref LoopbackTransport that behaves like a server built on the inerest_api_in_v1 library.
+     * The receiver answers time delta requests, checks the hash on each request, and passes the payload to a
+     * handler registered for the endpoint.  You can use this class to test REST API handlers without a remote
+     * server.
+     *
+     * The receiver accepts messages wrapped in the JSON or CBOR envelope, binary messages with a trailing hash,
+     * and messages that carry the hash in the \ref InesonicRestHandlerBase::signatureHeader request header.  Hashes
+     * from the current signing window and its neighbors are accepted.
+     *
+     * Requests to unknown endpoints receive status 404.  Malformed messages receive status 400.  Messages with an
+     * invalid hash receive status 401.
+     */
+    class REST_API_OUT_V1_PUBLIC_API InesonicLoopbackReceiver:public LoopbackTransport::Receiver {
+        public:
+            /**
+             * Type used to represent an endpoint handler.  The handler receives the endpoint and the payload after
+             * the hash has been checked.  The handler returns the response to send back.
+             */
+            typedef std::function<Response(const QString&, const QByteArray&)> Handler;
+
+            /**
+             * Constructor
+             *
+             * \param[in] defaultSecret The secret used for endpoints without their own secret.
+             */
+            InesonicLoopbackReceiver(const QByteArray& defaultSecret = QByteArray());
+
+            ~InesonicLoopbackReceiver() override;
+
+            /**
+             * Method you can use to set the secret used for endpoints without their own secret.
+             *
+             * \param[in] newDefaultSecret The new default secret.
+             */
+            void setDefaultSecret(const QByteArray& newDefaultSecret);
+
+            /**
+             * Method you can use to register a handler for an endpoint.
+             *
+             * \param[in] endpoint The endpoint to be handled.
+             *
+             * \param[in] handler  The handler for the endpoint.
+             *
+             * \param[in] secret   The secret for the endpoint.  An empty value causes the default secret to be used.
+             */
+            void registerEndpoint(
+                const QString&    endpoint,
+                const Handler&    handler,
+                const QByteArray& secret = QByteArray()
+            );
+
+            /**
+             * Method you can use to remove the handler for an endpoint.
+             *
+             * \param[in] endpoint The endpoint to be removed.
+             */
+            void unregisterEndpoint(const QString& endpoint);
+
+            /**
+             * Method you can use to set the path used for time delta requests.
+             *
+             * \param[in] newTimeDeltaSlug The new time delta path.
+             */
+            void setTimeDeltaSlug(const QString& newTimeDeltaSlug);
+
+            /**
+             * Method you can use to obtain the path used for time delta requests.
+             *
+             * \return Returns the time delta path.
+             */
+            const QString& timeDeltaSlug() const;
+
+            /**
+             * Method you can use to offset the receiver's clock from the local clock.  You can use this to test
+             * time delta tracking.
+             *
+             * \param[in] newClockOffset The new clock offset, in mSec.
+             */
+            void setClockOffset(long long newClockOffset);
+
+            /**
+             * Method you can use to obtain the receiver's clock offset.
+             *
+             * \return Returns the clock offset, in mSec.
+             */
+            long long clockOffset() const;
+
+            /**
+             * Method you can use to determine the number of requests passed to endpoint handlers.
+             *
+             * \return Returns the number of accepted requests.
+             */
+            unsigned long long numberAcceptedRequests() const;
+
+            /**
+             * Method you can use to determine the number of requests rejected due to an invalid hash or a
+             * malformed message.
+             *
+             * \return Returns the number of rejected requests.
+             */
+            unsigned long long numberRejectedRequests() const;
+
+            /**
+             * Method that is called to process a request.
+             *
+             * \param[in] request The network request.
+             *
+             * \param[in] payload The request payload.
+             *
+             * \return Returns the response to send back.
+             */
+            Response processRequest(const QNetworkRequest& request, const QByteArray& payload) override;
+
+        private:
+            /**
+             * Structure holding a registered endpoint.
+             */
+            struct Endpoint {
+                /**
+                 * The endpoint handler.
+                 */
+                Handler handler;
+
+                /**
+                 * The endpoint secret.  An empty value indicates that the default secret is used.
+                 */
+                QByteArray secret;
+            };
+
+            /**
+             * Method that answers a time delta request.
+             *
+             * \param[in] payload The request payload.
+             *
+             * \return Returns the response to send back.
+             */
+            Response processTimeDelta(const QByteArray& payload) const;
+
+            /**
+             * Method that separates a message into the payload and the hash.
+             *
+             * \param[in]  request The network request.
+             *
+             * \param[in]  message The received message.
+             *
+             * \param[out] payload The extracted payload.
+             *
+             * \param[out] hash    The extracted hash.
+             *
+             * \return Returns true on success.  Returns false if the message is malformed.
+             */
+            static bool unpackMessage(
+                const QNetworkRequest& request,
+                const QByteArray&      message,
+                QByteArray&            payload,
+                QByteArray&            hash
+            );
+
+            /**
+             * Method that checks the hash for a payload.
+             *
+             * \param[in] payload The payload.
+             *
+             * \param[in] hash    The received hash.
+             *
+             * \param[in] secret  The secret to check against.
+             *
+             * \return Returns true if the hash is valid.  Returns false if the hash is invalid.
+             */
+            bool hashValid(const QByteArray& payload, const QByteArray& hash, const QByteArray& secret) const;
+
+            /**
+             * Method that builds a response with a JSON body.
+             *
+             * \param[in] statusCode The HTTP status code.
+             *
+             * \param[in] body       The JSON body.
+             *
+             * \return Returns the response.
+             */
+            static Response jsonResponse(int statusCode, const QByteArray& body);
+
+            /**
+             * The default secret.
+             */
+            QByteArray currentDefaultSecret;
+
+            /**
+             * The registered endpoints.
+             */
+            QHash<QString, Endpoint> endpoints;
+
+            /**
+             * The time delta path.
+             */
+            QString currentTimeDeltaSlug;
+
+            /**
+             * The clock offset, in mSec.
+             */
+            long long currentClockOffset;
+
+            /**
+             * The number of accepted requests.
+             */
+            unsigned long long currentNumberAcceptedRequests;
+
+            /**
+             * The number of rejected requests.
+             */
+            unsigned long long currentNumberRejectedRequests;
+    };
+}
+
+#endif
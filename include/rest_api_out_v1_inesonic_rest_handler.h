@@ -27,8 +27,10 @@
 
 #include <QObject>
 #include <QString>
+#include <QHash>
 
 #include <cstdint>
+#include <functional>
 
 #include "rest_api_out_v1_common.h"
 #include "rest_api_out_v1_inesonic_rest_handler_base.h"
@@ -46,6 +48,18 @@ namespace RestApiOutV1 {
         Q_OBJECT
 
         public:
+            /**
+             * Type used for callbacks that receive a response.  The callback receives the request ID and the JSON
+             * response data.
+             */
+            typedef std::function<void(unsigned long long, const QJsonDocument&)> ResponseCallback;
+
+            /**
+             * Type used for callbacks that receive a failure.  The callback receives the request ID and a string
+             * describing the failure.
+             */
+            typedef std::function<void(unsigned long long, const QString&)> FailureCallback;
+
             /**
              * Constructor
              *
@@ -68,6 +82,150 @@ namespace RestApiOutV1 {
 
             ~InesonicRestHandler() override;
 
+            /**
+             * Method you can use to send a message to a remote server, with the result delivered to callbacks
+             * rather than through the \ref jsonResponse and \ref requestFailed signals.  Callbacks are invoked
+             * directly from the thread this handler lives in.
+             *
+             * \param[in] endpoint         The endpoint to send the message to.
+             *
+             * \param[in] jsonData         The JSON payload to be send.
+             *
+             * \param[in] responseCallback The callback to invoke when a response is received.
+             *
+             * \param[in] failureCallback  The callback to invoke if the request fails.  If empty, failures are
+             *                             reported through the \ref requestFailed signal.
+             *
+             * \return Returns an ID identifying this request.
+             */
+            unsigned long long post(
+                const QString&          endpoint,
+                const QJsonDocument&    jsonData,
+                const ResponseCallback& responseCallback,
+                const FailureCallback&  failureCallback = FailureCallback()
+            );
+
+            /**
+             * Method you can use to send a message to a remote server, with the result delivered to callbacks
+             * rather than through the \ref jsonResponse and \ref requestFailed signals.  Callbacks are invoked
+             * directly from the thread this handler lives in.
+             *
+             * \param[in] endpoint         The endpoint to send the message to.
+             *
+             * \param[in] jsonData         The JSON payload to be send.
+             *
+             * \param[in] responseCallback The callback to invoke when a response is received.
+             *
+             * \param[in] failureCallback  The callback to invoke if the request fails.  If empty, failures are
+             *                             reported through the \ref requestFailed signal.
+             *
+             * \return Returns an ID identifying this request.
+             */
+            unsigned long long post(
+                const QString&          endpoint,
+                const QJsonObject&      jsonData,
+                const ResponseCallback& responseCallback,
+                const FailureCallback&  failureCallback = FailureCallback()
+            );
+
+            /**
+             * Method you can use to send a message to a remote server, with the result delivered to callbacks
+             * rather than through the \ref jsonResponse and \ref requestFailed signals.  Callbacks are invoked
+             * directly from the thread this handler lives in.
+             *
+             * \param[in] endpoint         The endpoint to send the message to.
+             *
+             * \param[in] jsonData         The JSON payload to be send.
+             *
+             * \param[in] responseCallback The callback to invoke when a response is received.
+             *
+             * \param[in] failureCallback  The callback to invoke if the request fails.  If empty, failures are
+             *                             reported through the \ref requestFailed signal.
+             *
+             * \return Returns an ID identifying this request.
+             */
+            unsigned long long post(
+                const QString&          endpoint,
+                const QJsonArray&       jsonData,
+                const ResponseCallback& responseCallback,
+                const FailureCallback&  failureCallback = FailureCallback()
+            );
+
+            /**
+             * Method you can use to send a message to a remote server from any thread.  The payload is serialized on
+             * the calling thread and the request is started on the thread of the server this handler was
+             * constructed with.  This handler must live on that thread and must outlive the request.
+             *
+             * \param[in] endpoint         The endpoint to send the message to.
+             *
+             * \param[in] jsonData         The JSON payload to be send.
+             *
+             * \param[in] responseCallback The callback to invoke when a response is received.
+             *
+             * \param[in] failureCallback  The callback to invoke if the request fails.  If empty, failures are
+             *                             reported through the \ref requestFailed signal.
+             *
+             * \param[in] executor         The executor used to run the callbacks.  If empty, the callbacks are run on
+             *                             the server's thread.
+             */
+            void submit(
+                const QString&          endpoint,
+                const QJsonDocument&    jsonData,
+                const ResponseCallback& responseCallback,
+                const FailureCallback&  failureCallback = FailureCallback(),
+                const Server::Executor& executor = Server::Executor()
+            );
+
+            /**
+             * Method you can use to send a message to a remote server from any thread.  The payload is serialized on
+             * the calling thread and the request is started on the thread of the server this handler was
+             * constructed with.  This handler must live on that thread and must outlive the request.
+             *
+             * \param[in] endpoint         The endpoint to send the message to.
+             *
+             * \param[in] jsonData         The JSON payload to be send.
+             *
+             * \param[in] responseCallback The callback to invoke when a response is received.
+             *
+             * \param[in] failureCallback  The callback to invoke if the request fails.  If empty, failures are
+             *                             reported through the \ref requestFailed signal.
+             *
+             * \param[in] executor         The executor used to run the callbacks.  If empty, the callbacks are run on
+             *                             the server's thread.
+             */
+            void submit(
+                const QString&          endpoint,
+                const QJsonObject&      jsonData,
+                const ResponseCallback& responseCallback,
+                const FailureCallback&  failureCallback = FailureCallback(),
+                const Server::Executor& executor = Server::Executor()
+            );
+
+            /**
+             * Method you can use to send a message to a remote server from any thread.  The payload is serialized on
+             * the calling thread and the request is started on the thread of the server this handler was
+             * constructed with.  This handler must live on that thread and must outlive the request.
+             *
+             * \param[in] endpoint         The endpoint to send the message to.
+             *
+             * \param[in] jsonData         The JSON payload to be send.
+             *
+             * \param[in] responseCallback The callback to invoke when a response is received.
+             *
+             * \param[in] failureCallback  The callback to invoke if the request fails.  If empty, failures are
+             *                             reported through the \ref requestFailed signal.
+             *
+             * \param[in] executor         The executor used to run the callbacks.  If empty, the callbacks are run on
+             *                             the server's thread.
+             */
+            void submit(
+                const QString&          endpoint,
+                const QJsonArray&       jsonData,
+                const ResponseCallback& responseCallback,
+                const FailureCallback&  failureCallback = FailureCallback(),
+                const Server::Executor& executor = Server::Executor()
+            );
+
         public slots:
             /**
              * Slot you can use to send a message to a remote server.
@@ -75,8 +233,11 @@ namespace RestApiOutV1 {
              * \param[in] endpoint The endpoint to send the message to.
              *
              * \param[in] jsonData The JSON payload to be send.
+             *
+             * \return Returns an ID identifying this request.  The ID is included in the \ref jsonResponse and
+             *         \ref requestFailed signals.
              */
-            void post(const QString& endpoint, const QJsonDocument& jsonData);
+            unsigned long long post(const QString& endpoint, const QJsonDocument& jsonData);
 
             /**
              * Slot you can use to send a message to a remote server.
@@ -84,8 +245,11 @@ namespace RestApiOutV1 {
              * \param[in] endpoint The endpoint to send the message to.
              *
              * \param[in] jsonData The JSON payload to be send.
+             *
+             * \return Returns an ID identifying this request.  The ID is included in the \ref jsonResponse and
+             *         \ref requestFailed signals.
              */
-            void post(const QString& endpoint, const QJsonObject& jsonData);
+            unsigned long long post(const QString& endpoint, const QJsonObject& jsonData);
 
             /**
              * Slot you can use to send a message to a remote server.
@@ -93,79 +257,150 @@ namespace RestApiOutV1 {
              * \param[in] endpoint The endpoint to send the message to.
              *
              * \param[in] jsonData The JSON payload to be send.
+             *
+             * \return Returns an ID identifying this request.  The ID is included in the \ref jsonResponse and
+             *         \ref requestFailed signals.
              */
-            void post(const QString& endpoint, const QJsonArray& jsonData);
+            unsigned long long post(const QString& endpoint, const QJsonArray& jsonData);
 
         signals:
             /**
-             * Signal that is emitted when a response to the request is received.
+             * Signal that is emitted when a response to a request is received.
+             *
+             * \param[out] requestId The ID of the request.
              *
-             * \param[out] jsonData The JSON response data.
+             * \param[out] jsonData  The JSON response data.
              */
-            void jsonResponse(const QJsonDocument& jsonData);
+            void jsonResponse(unsigned long long requestId, const QJsonDocument& jsonData);
 
             /**
-             * Signal that is emitted when the transmission fails.
+             * Signal that is emitted when a request fails.
+             *
+             * \param[out] requestId   The ID of the request.
              *
              * \param[out] errorString a string providing an error message.
              */
-            void requestFailed(const QString& errorString);
-
-        private slots:
-            /**
-             * Slot that is triggered upon receipt of a response or timeout.
-             */
-            void responseReceived();
+            void requestFailed(unsigned long long requestId, const QString& errorString);
 
         protected:
             /**
              * Method you can overload to process a received response.  The default implementation will trigger the
              * \ref jsonResponse signal.
              *
-             * \param[in] jsonData The received JSON response.
+             * \param[in] requestId The ID of the request.
+             *
+             * \param[in] jsonData  The received JSON response.
              */
-            virtual void processJsonResponse(const QJsonDocument& jsonData);
+            virtual void processJsonResponse(unsigned long long requestId, const QJsonDocument& jsonData);
 
             /**
              * Method you can overload to process a failed transmisison attempt.  The default implementation will
              * trigger the \ref requestFailed signal.
              *
+             * \param[in] requestId   The ID of the request.
+             *
              * \param[in] errorString a string providing an error message.
              */
-            virtual void processRequestFailed(const QString& errorString);
+            virtual void processRequestFailed(unsigned long long requestId, const QString& errorString);
+
+            /**
+             * Method that is called once per request to encode the payload.  The payload is base64 encoded and
+             * placed in the message envelope, which is left open for the hash.
+             *
+             * \param[in] payload The request payload.
+             *
+             * \return Returns the leading portion of the message envelope.
+             */
+            QByteArray encodePayload(const QByteArray& payload) override;
 
             /**
-             * Method that is triggered when the timestamp is successfully updated. The default implementation
-             * reissues the request.
+             * Method that is called to build the message sent for a request.
+             *
+             * \param[in] encodedPayload The payload as returned by \ref encodePayload.
+             *
+             * \param[in] hash           The hash calculated for the payload.
+             *
+             * \return Returns the message to be sent.
+             */
+            QByteArray buildMessage(const QByteArray& encodedPayload, const QByteArray& hash) override;
+
+            /**
+             * Method that is called to determine the content type of sent messages.
+             *
+             * \return Returns the content type.
              */
-            void timestampUpdated() override;
+            QString messageContentType() const override;
 
             /**
-             * Method that is triggered when a timestamp update has failed. The default implementation triggers a call
-             * to \ref processRequestFailed.
+             * Method that is called when a request completes successfully.
+             *
+             * \param[in] requestId The ID of the completed request.
+             *
+             * \param[in] reply     The network reply holding the response.
              */
-            void timestampUpdateFailed() override;
+            void processReply(unsigned long long requestId, QNetworkReply* reply) override;
+
+            /**
+             * Method that is called when a request fails.
+             *
+             * \param[in] requestId   The ID of the failed request.
+             *
+             * \param[in] errorString A string describing the failure.
+             */
+            void processFailure(unsigned long long requestId, const QString& errorString) override;
 
         private:
             /**
-             * The number of remaining retries for this request.
+             * Method that starts a request for an already serialized payload.
+             *
+             * \param[in] endpoint The endpoint to send the message to.
+             *
+             * \param[in] payload  The serialized JSON payload.
+             *
+             * \param[in] setup    Optional function used to register callbacks for the request.
+             *
+             * \return Returns an ID identifying this request.
              */
-            unsigned retriesRemaining;
+            unsigned long long postPayload(
+                const QString&      endpoint,
+                const QByteArray&   payload,
+                const RequestSetup& setup = RequestSetup()
+            );
 
             /**
-             * Value holding the current request payload.
+             * Method that registers callbacks for a request.
+             *
+             * \param[in] requestId        The ID of the request.
+             *
+             * \param[in] responseCallback The callback to invoke when a response is received.
+             *
+             * \param[in] failureCallback  The callback to invoke if the request fails.
              */
-            QByteArray currentPayload;
+            void registerCallbacks(
+                unsigned long long      requestId,
+                const ResponseCallback& responseCallback,
+                const FailureCallback&  failureCallback
+            );
 
             /**
-             * The full URL for the current pending request.
+             * Structure holding the callbacks for a request.
              */
-            QUrl currentUrl;
+            struct Callbacks {
+                /**
+                 * The callback to invoke when a response is received.
+                 */
+                ResponseCallback responseCallback;
+
+                /**
+                 * The callback to invoke if the request fails.
+                 */
+                FailureCallback failureCallback;
+            };
 
             /**
-             * The current pending network reply.
+             * Hash table of callbacks for outstanding requests, by request ID.
              */
-            QNetworkReply* pendingReply;
+            QHash<unsigned long long, Callbacks> requestCallbacks;
     };
 }
 
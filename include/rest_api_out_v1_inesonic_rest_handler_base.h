@@ -28,15 +28,26 @@
 #include <QObject>
 #include <QString>
 #include <QByteArray>
+#include <QUrl>
+#include <QPointer>
+#include <QSet>
+#include <QHash>
+#include <QList>
+#include <QElapsedTimer>
 
 #include <cstdint>
+#include <functional>
 
 #include "rest_api_out_v1_common.h"
 #include "rest_api_out_v1_server.h"
+#include "rest_api_out_v1_hmac_sha256.h"
+
+class QNetworkReply;
 
 namespace RestApiOutV1 {
     /**
-     * Base class for Inesonic outbound REST API handlers.
+     * Base class for Inesonic outbound REST API handlers.  The class tracks any number of outstanding requests,
+     * each identified by a request ID, along with the retry, time delta update, and hedging state for each request.
      */
     class REST_API_OUT_V1_PUBLIC_API InesonicRestHandlerBase:public Server::RestApi {
         public:
@@ -45,6 +56,16 @@ namespace RestApiOutV1 {
              */
             static const unsigned secretLength;
 
+            /**
+             * The duration of a signing window, in mSec.
+             */
+            static const long long signingWindow;
+
+            /**
+             * The name of the request header used to carry the hash when header signatures are enabled.
+             */
+            static const char signatureHeader[];
+
             /**
              * Constructor
              *
@@ -70,6 +91,100 @@ namespace RestApiOutV1 {
              */
             void setSecret(const QByteArray& newSecret);
 
+            /**
+             * Method you can use to mark an endpoint as idempotent.  Requests to idempotent endpoints are hedged: if
+             * no response is received within the hedge delay, a second, independently signed, copy of the request is
+             * sent.  The first response received is used and the other request is aborted.
+             *
+             * \param[in] endpoint      The endpoint to be marked.
+             *
+             * \param[in] nowIdempotent If true, the endpoint is idempotent.  If false, the endpoint is not
+             *                          idempotent.
+             */
+            void setIdempotent(const QString& endpoint, bool nowIdempotent = true);
+
+            /**
+             * Method you can use to determine if an endpoint is marked as idempotent.
+             *
+             * \param[in] endpoint The endpoint to check.
+             *
+             * \return Returns true if the endpoint is marked as idempotent.  Returns false if the endpoint is not
+             *         marked as idempotent.
+             */
+            bool isIdempotent(const QString& endpoint) const;
+
+            /**
+             * Method you can use to set the delay before a hedged request is sent.
+             *
+             * \param[in] newHedgeDelay The new hedge delay, in mSec.  A negative value causes the server's 95th
+             *                          percentile latency to be used.
+             */
+            void setHedgeDelay(long long newHedgeDelay);
+
+            /**
+             * Method you can use to obtain the delay before a hedged request is sent.
+             *
+             * \return Returns the hedge delay, in mSec.  A negative value indicates that the server's 95th
+             *         percentile latency is used.
+             */
+            long long hedgeDelay() const;
+
+            /**
+             * Method you can use to set the priority class used to schedule requests from this REST API.
+             *
+             * \param[in] newPriority The new priority class.
+             */
+            void setPriority(Server::Priority newPriority);
+
+            /**
+             * Method you can use to obtain the priority class used to schedule requests from this REST API.
+             *
+             * \return Returns the current priority class.
+             */
+            Server::Priority priority() const;
+
+            /**
+             * Method you can use to enable or disable header signatures.  When enabled, the payload is sent
+             * unchanged, without the usual envelope, and the base64 encoded hash is sent in the
+             * \ref signatureHeader request header.  The remote server must support this mode.  Header signatures
+             * are disabled by default.
+             *
+             * \param[in] nowEnabled If true, header signatures will be enabled.  If false, header signatures will be
+             *                       disabled.
+             */
+            void setHeaderSignatureEnabled(bool nowEnabled = true);
+
+            /**
+             * Method you can use to disable or enable header signatures.
+             *
+             * \param[in] nowDisabled If true, header signatures will be disabled.  If false, header signatures will
+             *                        be enabled.
+             */
+            void setHeaderSignatureDisabled(bool nowDisabled = true);
+
+            /**
+             * Method you can use to determine if header signatures are enabled.
+             *
+             * \return Returns true if header signatures are enabled.  Returns false if header signatures are
+             *         disabled.
+             */
+            bool headerSignatureEnabled() const;
+
+            /**
+             * Method you can use to determine if header signatures are disabled.
+             *
+             * \return Returns true if header signatures are disabled.  Returns false if header signatures are
+             *         enabled.
+             */
+            bool headerSignatureDisabled() const;
+
+            /**
+             * Method you can use to determine the number of outstanding requests.
+             *
+             * \return Returns the number of requests that have not yet completed or failed.
+             */
+            unsigned long numberPendingRequests() const;
+
         protected:
             /**
              * The length of generated hashes, in bytes.
@@ -77,7 +192,15 @@ namespace RestApiOutV1 {
             static const unsigned hashLength;
 
             /**
-             * Method you can use to calculate the hash for a data payload.
+             * Type used for functions that set up per-request state.  The function receives the ID assigned to the
+             * new request and is called before the request can complete.
+             */
+            typedef std::function<void(unsigned long long)> RequestSetup;
+
+            /**
+             * Method you can use to calculate the hash for a data payload.  The hash is tied to the signing window
+             * that is expected to be current when the request arrives at the server, based on the server's time
+             * delta and expected transit time.
              *
              * \param[in] payload The payload to calculate the time sensitive hash for.
              *
@@ -85,11 +208,422 @@ namespace RestApiOutV1 {
              */
             QByteArray calculateHash(const QByteArray& payload);
 
+            /**
+             * Method you can use to determine the distance between the expected arrival time of the last signed
+             * request and the nearest signing window boundary.
+             *
+             * \return Returns the signature margin for the last signed request, in mSec.
+             */
+            inline long long signatureMargin() const {
+                return currentSignatureMargin;
+            }
+
+            /**
+             * Method that makes the object used for reply connections a child of the handler object.  This allows
+             * the handler to be moved to another thread, such as a server's network thread, with
+             * QObject::moveToThread.
+             *
+             * \param[in] handler The handler object.
+             */
+            void attachRequestContext(QObject* handler);
+
+            /**
+             * Method you can use to run a task on the thread of the server this handler was constructed with.  This
+             * method can be called from any thread.
+             *
+             * \param[in] task The task to be run.
+             */
+            void submitTask(const Server::Task& task);
+
+            /**
+             * Method you can use to start a new request.  The request is sent to the server most recently
+             * selected by \ref Server::RestApi::selectServer.  If the time delta is being updated, the request is
+             * held until the update completes.
+             *
+             * \param[in] endpoint The endpoint the request is sent to.
+             *
+             * \param[in] url      The full URL for the request.
+             *
+             * \param[in] payload  The payload to be signed and sent.
+             *
+             * \param[in] setup    Optional function used to register state, such as callbacks, for the request.
+             *                     The function is called before the request is sent so it can't miss a response
+             *                     or failure reported while the request is being started.
+             *
+             * \return Returns the ID assigned to the request.
+             */
+            unsigned long long startRequest(
+                const QString&      endpoint,
+                const QUrl&         url,
+                const QByteArray&   payload,
+                const RequestSetup& setup = RequestSetup()
+            );
+
+            /**
+             * Method that is called once per request to convert the payload into the form passed to
+             * \ref buildMessage.  The result is reused each time the request is sent, including retries and hedged
+             * copies, so work that does not depend on the hash should be done here.  The default implementation
+             * returns the payload unchanged.
+             *
+             * \param[in] payload The request payload.
+             *
+             * \return Returns the encoded payload.
+             */
+            virtual QByteArray encodePayload(const QByteArray& payload);
+
+            /**
+             * Method that is called to build the message sent for a request.
+             *
+             * \param[in] encodedPayload The payload as returned by \ref encodePayload.
+             *
+             * \param[in] hash           The hash calculated for the payload.
+             *
+             * \return Returns the message to be sent.
+             */
+            virtual QByteArray buildMessage(const QByteArray& encodedPayload, const QByteArray& hash) = 0;
+
+            /**
+             * Method that is called to determine the content type of sent messages.
+             *
+             * \return Returns the content type.
+             */
+            virtual QString messageContentType() const = 0;
+
+            /**
+             * Method that is called when a request completes successfully.
+             *
+             * \param[in] requestId The ID of the completed request.
+             *
+             * \param[in] reply     The network reply holding the response.  The reply is deleted after this
+             *                      method returns.
+             */
+            virtual void processReply(unsigned long long requestId, QNetworkReply* reply) = 0;
+
+            /**
+             * Method that is called when a request fails.
+             *
+             * \param[in] requestId   The ID of the failed request.
+             *
+             * \param[in] errorString A string describing the failure.
+             */
+            virtual void processFailure(unsigned long long requestId, const QString& errorString) = 0;
+
+            /**
+             * Method that is triggered when the timestamp is successfully updated.  The method sends any requests
+             * that were held waiting for the update.
+             */
+            void timestampUpdated() override;
+
+            /**
+             * Method that is triggered when a timestamp update has failed.  The method fails any requests that were
+             * held waiting for the update.
+             */
+            void timestampUpdateFailed() override;
+
         private:
+            /**
+             * Structure holding the state of a single outstanding request.
+             */
+            struct PendingRequest {
+                /**
+                 * The request ID.
+                 */
+                unsigned long long requestId;
+
+                /**
+                 * The server handling this request.  Null if the server was destroyed while the request was
+                 * outstanding.
+                 */
+                QPointer<Server> server;
+
+                /**
+                 * The endpoint the request is sent to.
+                 */
+                QString endpoint;
+
+                /**
+                 * The full URL for the request.
+                 */
+                QUrl url;
+
+                /**
+                 * The request payload.
+                 */
+                QByteArray payload;
+
+                /**
+                 * The payload as returned by \ref encodePayload.
+                 */
+                QByteArray encodedPayload;
+
+                /**
+                 * Flag indicating that the payload has been encoded.
+                 */
+                bool isEncoded;
+
+                /**
+                 * Flag indicating that the hash is sent in a request header rather than in the message.
+                 */
+                bool headerSignature;
+
+                /**
+                 * The number of remaining retries.
+                 */
+                unsigned retriesRemaining;
+
+                /**
+                 * The signature margin of the most recently sent copy of the request.
+                 */
+                long long signatureMargin;
+
+                /**
+                 * The network reply for the primary copy of the request.
+                 */
+                QNetworkReply* reply;
+
+                /**
+                 * The network reply for the hedged copy of the request.
+                 */
+                QNetworkReply* hedgeReply;
+
+                /**
+                 * The time, relative to the request timer, when the hedged copy was sent.
+                 */
+                long long hedgeSendTime;
+
+                /**
+                 * Value incremented each time the primary copy is issued.  Used to ignore hedge timers started for
+                 * an earlier attempt, such as one rejected with an authentication failure and retried.
+                 */
+                unsigned attempt;
+
+                /**
+                 * The scheduler ticket for the primary copy of the request.  A value of 0 indicates that the primary
+                 * copy is not waiting to be issued.
+                 */
+                unsigned long long ticket;
+
+                /**
+                 * The scheduler ticket for the hedged copy of the request.  A value of 0 indicates that the hedged
+                 * copy is not waiting to be issued.
+                 */
+                unsigned long long hedgeTicket;
+
+                /**
+                 * Timer used to measure request latency.
+                 */
+                QElapsedTimer timer;
+            };
+
+            /**
+             * Method that calculates the hash for a payload sent to a specific server.
+             *
+             * \param[in] payload The payload to calculate the time sensitive hash for.
+             *
+             * \param[in] server  The server the payload will be sent to.
+             *
+             * \return Returns the hash to be used with this payload.
+             */
+            QByteArray calculateHash(const QByteArray& payload, Server* server);
+
+            /**
+             * Method that schedules the primary copy of a request with the server.
+             *
+             * \param[in] request The request to be sent.
+             */
+            void sendRequest(PendingRequest* request);
+
+            /**
+             * Method that schedules one copy of a request with the server.
+             *
+             * \param[in] request The request to be sent.
+             *
+             * \param[in] isHedge If true, the hedged copy is scheduled.  If false, the primary copy is scheduled.
+             *
+             * \return Returns the scheduler ticket.  A value of 0 is returned if the copy was issued immediately.
+             */
+            unsigned long long scheduleRequest(PendingRequest* request, bool isHedge);
+
+            /**
+             * Method that is called by the server's scheduler to issue one copy of a request.  Issuing the primary
+             * copy also starts the timer for the hedged copy, if needed.
+             *
+             * \param[in] requestId The ID of the request.
+             *
+             * \param[in] isHedge   If true, the hedged copy is issued.  If false, the primary copy is issued.
+             *
+             * \return Returns the network reply for the issued copy.  A null pointer is returned if the copy is no
+             *         longer needed.
+             */
+            QNetworkReply* issueRequest(unsigned long long requestId, bool isHedge);
+
+            /**
+             * Method that signs and transmits one copy of a request.
+             *
+             * \param[in] request The request to be transmitted.
+             *
+             * \return Returns the network reply for the transmitted copy.
+             */
+            QNetworkReply* transmitRequest(PendingRequest* request);
+
+            /**
+             * Method that sends the hedged copy of a request.
+             *
+             * \param[in] requestId The ID of the request to be hedged.
+             *
+             * \param[in] attempt   The attempt the hedge timer was started for.  The hedged copy is not sent if
+             *                      the primary copy has been issued again since.
+             */
+            void sendHedge(unsigned long long requestId, unsigned attempt);
+
+            /**
+             * Method that is triggered when a network reply finishes.
+             *
+             * \param[in] reply The finished reply.
+             */
+            void replyFinished(QNetworkReply* reply);
+
+            /**
+             * Method that cancels any copies of a request still waiting in the server's scheduler.
+             *
+             * \param[in] request The request to be updated.
+             */
+            void cancelScheduled(PendingRequest* request);
+
+            /**
+             * Method that aborts and releases any outstanding network replies for a request.  Copies still waiting
+             * in the server's scheduler are also canceled.
+             *
+             * \param[in] request The request to be updated.
+             */
+            void abortReplies(PendingRequest* request);
+
+            /**
+             * Method that removes requests no longer waiting on a time delta update from the list of waiting
+             * requests.
+             *
+             * \return Returns the list of requests that are no longer waiting.
+             */
+            QList<PendingRequest*> takeReadyRequests();
+
+            /**
+             * Method that sends the next batch of requests released after a time delta update.  If requests
+             * remain, the next batch is scheduled using the server's resume pacing.
+             */
+            void releaseRequests();
+
+            /**
+             * The signature margin for the last signed request.
+             */
+            long long currentSignatureMargin;
+
             /**
              * The current secret to use for web requests.
              */
             QByteArray currentSecret;
+
+            /**
+             * Structure holding a signing key prepared for one signing window.
+             */
+            struct SigningKey {
+                SigningKey():window(0),generation(0),valid(false) {}
+
+                /**
+                 * The prepared HMAC key.
+                 */
+                HmacSha256 hmac;
+
+                /**
+                 * The signing window the key was prepared for.
+                 */
+                unsigned long long window;
+
+                /**
+                 * The server's default secret generation the key was prepared from.
+                 */
+                unsigned long long generation;
+
+                /**
+                 * Flag indicating that the key has been prepared.
+                 */
+                bool valid;
+            };
+
+            /**
+             * The signing key prepared from the current secret.
+             */
+            SigningKey secretSigningKey;
+
+            /**
+             * The signing keys prepared from each server's default secret.
+             */
+            QHash<const Server*, SigningKey> defaultSigningKeys;
+
+            /**
+             * The rate limiting key for the current secret.  An empty value indicates the server's default secret.
+             */
+            QByteArray secretRateKey;
+
+            /**
+             * The current hedge delay.
+             */
+            long long currentHedgeDelay;
+
+            /**
+             * The priority class used to schedule requests.
+             */
+            Server::Priority currentPriority;
+
+            /**
+             * Flag indicating if header signatures are enabled.
+             */
+            bool currentHeaderSignatureEnabled;
+
+            /**
+             * The set of endpoints marked as idempotent.
+             */
+            QSet<QString> idempotentEndpoints;
+
+            /**
+             * The ID to assign to the next request.
+             */
+            unsigned long long nextRequestId;
+
+            /**
+             * Hash table of outstanding requests by request ID.
+             */
+            QHash<unsigned long long, PendingRequest*> pendingRequests;
+
+            /**
+             * Hash table of outstanding requests by network reply.
+             */
+            QHash<QNetworkReply*, PendingRequest*> requestsByReply;
+
+            /**
+             * List of requests waiting on a time delta update.
+             */
+            QList<PendingRequest*> waitingRequests;
+
+            /**
+             * List of requests released after a time delta update that have not yet been sent.
+             */
+            QList<PendingRequest*> releasingRequests;
+
+            /**
+             * Flag indicating that a batch of released requests is scheduled to be sent.
+             */
+            bool releasePending;
+
+            /**
+             * The server this handler was constructed with.  Used to route submissions from other threads.
+             */
+            Server* submissionServer;
+
+            /**
+             * Object used as the context for reply and timer connections.  Connections are broken automatically
+             * when this handler is destroyed.
+             */
+            QObject requestContext;
     };
 }
 
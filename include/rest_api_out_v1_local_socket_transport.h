@@ -0,0 +1,78 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref RestApiOutV1::LocalSocketTransport class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project inerest_api_out_v1 */
+
+#ifndef REST_API_OUT_V1_LOCAL_SOCKET_TRANSPORT_H
+#define REST_API_OUT_V1_LOCAL_SOCKET_TRANSPORT_H
+
+#include <QObject>
+#include <QString>
+#include <QUrl>
+
+#include "rest_api_out_v1_common.h"
+#include "rest_api_out_v1_pipelined_http_client.h"
+
+namespace RestApiOutV1 {
+    /**
+     * Transport that sends HTTP/1.1 post requests to a local server, such as a sidecar process listening on a Unix
+     * domain socket or a Windows named pipe.  Requests are pipelined over persistent connections in the same manner
+     * as \ref RestApiOutV1::PipelinedHttpClient.
+     */
+    class REST_API_OUT_V1_PUBLIC_API LocalSocketTransport:public PipelinedHttpClient {
+        Q_OBJECT
+
+        public:
+            /**
+             * Constructor
+             *
+             * \param[in] serverName    The name of the local server.  On Unix platforms, this is the path to the
+             *                          socket.
+             *
+             * \param[in] schemeAndHost The scheme and host used to generate the Host header.
+             *
+             * \param[in] parent        Pointer to the parent object.
+             */
+            LocalSocketTransport(
+                const QString& serverName,
+                const QUrl&    schemeAndHost = QUrl("http://localhost"),
+                QObject*       parent = nullptr
+            );
+
+            ~LocalSocketTransport() override;
+
+            /**
+             * Method you can use to obtain the name of the local server.
+             *
+             * \return Returns the local server name.
+             */
+            QString serverName() const;
+
+        private:
+            /**
+             * The local server name.
+             */
+            QString currentServerName;
+    };
+}
+
+#endif
@@ -0,0 +1,145 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref RestApiOutV1::LoopbackTransport class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project inerest_api_out_v1 */
+
+#ifndef REST_API_OUT_V1_LOOPBACK_TRANSPORT_H
+#define REST_API_OUT_V1_LOOPBACK_TRANSPORT_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+
+#include "rest_api_out_v1_common.h"
+#include "rest_api_out_v1_transport.h"
+
+namespace RestApiOutV1 {
+    class PipelinedNetworkReply;
+
+    /**
+     * Transport that delivers requests to a receiver in the same process without touching the network.  The
+     * transport is useful for testing and for applications that embed the remote service.
+     *
+     * Requests are delivered to the receiver from the transport's thread once control returns to the event loop.
+     */
+    class REST_API_OUT_V1_PUBLIC_API LoopbackTransport:public Transport {
+        Q_OBJECT
+
+        public:
+            /**
+             * Pure virtual class you can overload to process requests delivered by the transport.
+             */
+            class REST_API_OUT_V1_PUBLIC_API Receiver {
+                public:
+                    /**
+                     * Structure holding a response to a request.
+                     */
+                    struct Response {
+                        /**
+                         * The HTTP status code.
+                         */
+                        int statusCode;
+
+                        /**
+                         * The response content type.  An empty value omits the Content-Type header.
+                         */
+                        QByteArray contentType;
+
+                        /**
+                         * The response body.
+                         */
+                        QByteArray body;
+                    };
+
+                    virtual ~Receiver();
+
+                    /**
+                     * Method that is called to process a request.
+                     *
+                     * \param[in] request The network request.
+                     *
+                     * \param[in] payload The request payload.
+                     *
+                     * \return Returns the response to send back.
+                     */
+                    virtual Response processRequest(const QNetworkRequest& request, const QByteArray& payload) = 0;
+            };
+
+            /**
+             * Constructor
+             *
+             * \param[in] receiver The receiver that should process requests.  The receiver is not owned by the
+             *                     transport.
+             *
+             * \param[in] parent   Pointer to the parent object.
+             */
+            LoopbackTransport(Receiver* receiver = nullptr, QObject* parent = nullptr);
+
+            ~LoopbackTransport() override;
+
+            /**
+             * Method you can use to set the receiver.
+             *
+             * \param[in] newReceiver The new receiver.  The receiver is not owned by the transport.  Requests are
+             *                        failed while no receiver is set.
+             */
+            void setReceiver(Receiver* newReceiver);
+
+            /**
+             * Method you can use to obtain the current receiver.
+             *
+             * \return Returns a pointer to the current receiver.
+             */
+            Receiver* receiver() const;
+
+            /**
+             * Method you can use to issue a post request.
+             *
+             * \param[in] request The network request to be sent.
+             *
+             * \param[in] payload The payload to be sent.
+             *
+             * \return Returns a newly created network reply instance.
+             */
+            QNetworkReply* post(const QNetworkRequest& request, const QByteArray& payload) override;
+
+        private:
+            /**
+             * Method that delivers a request to the receiver and populates the reply.
+             *
+             * \param[in] reply   The reply to be populated.
+             *
+             * \param[in] request The network request.
+             *
+             * \param[in] payload The request payload.
+             */
+            void deliver(PipelinedNetworkReply* reply, const QNetworkRequest& request, const QByteArray& payload);
+
+            /**
+             * The current receiver.
+             */
+            Receiver* currentReceiver;
+    };
+}
+
+#endif
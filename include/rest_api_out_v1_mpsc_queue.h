@@ -0,0 +1,160 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref RestApiOutV1::MpscQueue template class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project inerest_api_out_v1 */
+
+#ifndef REST_API_OUT_V1_MPSC_QUEUE_H
+#define REST_API_OUT_V1_MPSC_QUEUE_H
+
+#include <atomic>
+#include <utility>
+
+#include "rest_api_out_v1_common.h"
+
+namespace RestApiOutV1 {
+    /**
+     * Unbounded lock-free multiple producer, single consumer queue.  Any number of threads may call \ref push
+     * concurrently.  Only a single thread may call \ref pop at any given time.
+     *
+     * Pushing is wait-free, requiring a single atomic exchange.  A pop can transiently report the queue as empty
+     * while a concurrent push is part way through linking its entry.  The producer's push is complete once
+     * \ref push returns, so callers that signal the consumer after pushing will never miss an entry.
+     *
+     * \param T The type of the queued values.  The type must be default constructible and movable.
+     */
+    template<typename T> class MpscQueue {
+        public:
+            MpscQueue() {
+                Node* stub = new Node;
+                head.store(stub, std::memory_order_relaxed);
+                tail = stub;
+            }
+
+            ~MpscQueue() {
+                T value;
+                while (pop(value)) {}
+
+                delete tail;
+            }
+
+            MpscQueue(const MpscQueue&) = delete;
+            MpscQueue& operator=(const MpscQueue&) = delete;
+
+            /**
+             * Method you can use to add a value to the queue.  This method can be called from any thread.
+             *
+             * \param[in] value The value to be added.
+             */
+            void push(const T& value) {
+                Node* node = new Node;
+                node->value = value;
+                link(node);
+            }
+
+            /**
+             * Method you can use to add a value to the queue.  This method can be called from any thread.
+             *
+             * \param[in] value The value to be added.
+             */
+            void push(T&& value) {
+                Node* node = new Node;
+                node->value = std::move(value);
+                link(node);
+            }
+
+            /**
+             * Method you can use to remove the oldest value from the queue.  This method must only be called from
+             * the consumer.
+             *
+             * \param[out] value The location to receive the removed value.
+             *
+             * \return Returns true if a value was removed.  Returns false if the queue is empty.
+             */
+            bool pop(T& value) {
+                bool  result;
+                Node* next = tail->next.load(std::memory_order_acquire);
+
+                if (next != nullptr) {
+                    value = std::move(next->value);
+                    next->value = T();
+
+                    delete tail;
+                    tail   = next;
+                    result = true;
+                } else {
+                    result = false;
+                }
+
+                return result;
+            }
+
+            /**
+             * Method you can use to determine if the queue is empty.  This method must only be called from the
+             * consumer.
+             *
+             * \return Returns true if the queue is empty.  Returns false if the queue holds at least one value.
+             */
+            bool isEmpty() const {
+                return tail->next.load(std::memory_order_acquire) == nullptr;
+            }
+
+        private:
+            /**
+             * Queue entry.  The entry at the tail is always a placeholder whose value has already been consumed.
+             */
+            struct Node {
+                Node():next(nullptr) {}
+
+                /**
+                 * The next, newer, entry.
+                 */
+                std::atomic<Node*> next;
+
+                /**
+                 * The queued value.
+                 */
+                T value;
+            };
+
+            /**
+             * Method that links a new entry at the head of the queue.
+             *
+             * \param[in] node The entry to be linked.
+             */
+            void link(Node* node) {
+                Node* previous = head.exchange(node, std::memory_order_acq_rel);
+                previous->next.store(node, std::memory_order_release);
+            }
+
+            /**
+             * The most recently pushed entry.  Updated by producers.
+             */
+            alignas(64) std::atomic<Node*> head;
+
+            /**
+             * The placeholder entry preceding the oldest value.  Updated by the consumer.
+             */
+            alignas(64) Node* tail;
+    };
+}
+
+#endif
@@ -0,0 +1,408 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref RestApiOutV1::PipelinedHttpClient class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project inerest_api_out_v1 */
+
+#ifndef REST_API_OUT_V1_PIPELINED_HTTP_CLIENT_H
+#define REST_API_OUT_V1_PIPELINED_HTTP_CLIENT_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QUrl>
+#include <QList>
+#include <QHash>
+#include <QPointer>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+
+#include "rest_api_out_v1_common.h"
+#include "rest_api_out_v1_pipelined_network_reply.h"
+#include "rest_api_out_v1_transport.h"
+
+class QIODevice;
+class QAbstractSocket;
+class QLocalSocket;
+
+namespace RestApiOutV1 {
+    /**
+     * Lightweight HTTP/1.1 client that sends post requests to a single host over a small number of persistent
+     * connections.  Requests are pipelined, so several requests can be outstanding on a connection at once.
+     * Fixed headers are serialized once and reused for every request.
+     *
+     * The client is intended for bulk traffic to a single trusted host.  Redirects and proxies are not supported.
+     * Because responses on a connection must arrive in order, requests that were sent on a connection that closes
+     * before they receive a response are reported as failed rather than being resent.
+     *
+     * The transfer timeout of each request, if any, bounds the time until the complete response is received.  A
+     * request that times out fails with QNetworkReply::TimeoutError.  Its connection is closed, as later responses
+     * on that connection can no longer be matched to their requests.
+     */
+    class REST_API_OUT_V1_PUBLIC_API PipelinedHttpClient:public QObject {
+        Q_OBJECT
+
+        public:
+            /**
+             * The default number of connections.
+             */
+            static const unsigned defaultNumberConnections;
+
+            /**
+             * The default maximum number of outstanding requests per connection.
+             */
+            static const unsigned defaultMaximumPipelineDepth;
+
+            /**
+             * Constructor
+             *
+             * \param[in] schemeAndHost The scheme and host to send requests to.  Both http and https are supported.
+             *
+             * \param[in] parent        Pointer to the parent object.
+             */
+            PipelinedHttpClient(const QUrl& schemeAndHost, QObject* parent = nullptr);
+
+            ~PipelinedHttpClient() override;
+
+            /**
+             * Method you can use to set the maximum number of connections to open to the host.
+             *
+             * \param[in] newNumberConnections The new number of connections.  A value of 0 is treated as 1.
+             */
+            void setNumberConnections(unsigned newNumberConnections);
+
+            /**
+             * Method you can use to determine the maximum number of connections to open to the host.
+             *
+             * \return Returns the maximum number of connections.
+             */
+            unsigned numberConnections() const;
+
+            /**
+             * Method you can use to set the maximum number of outstanding requests on a single connection.
+             *
+             * \param[in] newMaximumPipelineDepth The new maximum pipeline depth.  A value of 1 disables pipelining.
+             *                                    A value of 0 is treated as 1.
+             */
+            void setMaximumPipelineDepth(unsigned newMaximumPipelineDepth);
+
+            /**
+             * Method you can use to determine the maximum number of outstanding requests on a single connection.
+             *
+             * \return Returns the maximum pipeline depth.
+             */
+            unsigned maximumPipelineDepth() const;
+
+            /**
+             * Method you can use to issue a post request.
+             *
+             * \param[in] request The network request to be sent.  Only the URL path and query, and the raw headers,
+             *                    are used.
+             *
+             * \param[in] payload The payload to be sent.
+             *
+             * \return Returns a newly created network reply instance.
+             */
+            QNetworkReply* post(const QNetworkRequest& request, const QByteArray& payload) override;
+
+        protected:
+            /**
+             * Constructor for clients that connect to a local server rather than a network host.
+             *
+             * \param[in] localServerName The name of the local server to connect to.  An empty name causes the client
+             *                            to connect to the network host.
+             *
+             * \param[in] schemeAndHost   The scheme and host to send requests to.  For local servers, the value is
+             *                            only used to generate the Host header.
+             *
+             * \param[in] parent          Pointer to the parent object.
+             */
+            PipelinedHttpClient(const QString& localServerName, const QUrl& schemeAndHost, QObject* parent);
+
+        private:
+            /**
+             * Enumeration of response parser states.
+             */
+            enum class ParserState {
+                /**
+                 * Waiting for the status line.
+                 */
+                STATUS_LINE,
+
+                /**
+                 * Reading response headers.
+                 */
+                HEADERS,
+
+                /**
+                 * Reading a body with a known length.
+                 */
+                BODY,
+
+                /**
+                 * Reading a body that ends when the connection closes.
+                 */
+                BODY_UNTIL_CLOSE,
+
+                /**
+                 * Waiting for a chunk size line.
+                 */
+                CHUNK_SIZE,
+
+                /**
+                 * Reading chunk data.
+                 */
+                CHUNK_DATA,
+
+                /**
+                 * Waiting for the line ending that follows chunk data.
+                 */
+                CHUNK_DATA_END,
+
+                /**
+                 * Reading the trailer that follows the final chunk.
+                 */
+                CHUNK_TRAILER
+            };
+
+            /**
+             * Structure holding a request waiting to be sent.
+             */
+            struct OutgoingRequest {
+                /**
+                 * The reply for the request.
+                 */
+                QPointer<PipelinedNetworkReply> reply;
+
+                /**
+                 * The serialized request.
+                 */
+                QByteArray data;
+            };
+
+            /**
+             * Structure holding the state of a single connection.
+             */
+            struct Connection {
+                /**
+                 * The connection socket.
+                 */
+                QIODevice* socket;
+
+                /**
+                 * The connection socket, if the connection is to a network host.
+                 */
+                QAbstractSocket* networkSocket;
+
+                /**
+                 * The connection socket, if the connection is to a local server.
+                 */
+                QLocalSocket* localSocket;
+
+                /**
+                 * Flag indicating if the connection has been established.
+                 */
+                bool isConnected;
+
+                /**
+                 * Replies for requests sent on this connection, in the order they were sent.
+                 */
+                QList<QPointer<PipelinedNetworkReply>> outstandingReplies;
+
+                /**
+                 * Data received but not yet parsed.
+                 */
+                QByteArray receiveBuffer;
+
+                /**
+                 * The current parser state.
+                 */
+                ParserState parserState;
+
+                /**
+                 * The status code of the response being parsed.
+                 */
+                int statusCode;
+
+                /**
+                 * The reason phrase of the response being parsed.
+                 */
+                QByteArray reasonPhrase;
+
+                /**
+                 * The headers of the response being parsed.
+                 */
+                PipelinedNetworkReply::HeaderList headers;
+
+                /**
+                 * The body of the response being parsed.
+                 */
+                QByteArray body;
+
+                /**
+                 * The number of body or chunk bytes remaining.
+                 */
+                long long remainingBytes;
+
+                /**
+                 * Flag indicating that the server will close the connection after the current response.
+                 */
+                bool closeAfterResponse;
+            };
+
+            /**
+             * Method that sends queued requests on connections that have capacity, opening connections as needed.
+             */
+            void dispatch();
+
+            /**
+             * Method that opens a new connection.
+             */
+            void openConnection();
+
+            /**
+             * Method that is triggered when a connection is established.
+             *
+             * \param[in] connection The connection.
+             */
+            void connectionEstablished(Connection* connection);
+
+            /**
+             * Method that is triggered when data is received on a connection.
+             *
+             * \param[in] connection The connection.
+             */
+            void dataReceived(Connection* connection);
+
+            /**
+             * Method that is triggered when a connection is closed or fails.
+             *
+             * \param[in] connection The connection.
+             */
+            void connectionLost(Connection* connection);
+
+            /**
+             * Method that is triggered when a request's transfer timeout expires.
+             *
+             * \param[in] reply The reply for the request.
+             */
+            void replyTimedOut(PipelinedNetworkReply* reply);
+
+            /**
+             * Method that parses buffered response data.
+             *
+             * \param[in] connection The connection.
+             *
+             * \return Returns false if the response stream is malformed.  Returns true on success.
+             */
+            bool parseResponses(Connection* connection);
+
+            /**
+             * Method that resets the parser after the status line and headers have been received and determines how
+             * the body will be read.
+             *
+             * \param[in] connection The connection.
+             *
+             * \return Returns false if the headers are malformed.  Returns true on success.
+             */
+            bool startBody(Connection* connection);
+
+            /**
+             * Method that delivers the completed response to the oldest outstanding reply on a connection.
+             *
+             * \param[in] connection The connection.
+             */
+            void completeResponse(Connection* connection);
+
+            /**
+             * Method that closes a connection and fails any outstanding replies.
+             *
+             * \param[in] connection   The connection.
+             *
+             * \param[in] networkError The error to report for outstanding replies.
+             *
+             * \param[in] errorString  A description of the error.
+             */
+            void closeConnection(
+                Connection*                 connection,
+                QNetworkReply::NetworkError networkError,
+                const QString&              errorString
+            );
+
+            /**
+             * Method that obtains the serialized header block for a request, excluding the request line and content
+             * length.
+             *
+             * \param[in] request The request.
+             *
+             * \return Returns the serialized header block.
+             */
+            QByteArray headerBlock(const QNetworkRequest& request);
+
+            /**
+             * The name of the local server requests are sent to.  An empty name indicates a network host.
+             */
+            QString currentLocalServerName;
+
+            /**
+             * The scheme and host requests are sent to.
+             */
+            QUrl currentSchemeAndHost;
+
+            /**
+             * The serialized headers that are identical for every request.
+             */
+            QByteArray fixedHeaders;
+
+            /**
+             * Cache of serialized header blocks, keyed by the user agent and content type.
+             */
+            QHash<QByteArray, QByteArray> headerBlockCache;
+
+            /**
+             * The maximum number of connections.
+             */
+            unsigned currentNumberConnections;
+
+            /**
+             * The maximum number of outstanding requests per connection.
+             */
+            unsigned currentMaximumPipelineDepth;
+
+            /**
+             * The open connections.
+             */
+            QList<Connection*> connections;
+
+            /**
+             * Requests waiting to be sent.
+             */
+            QList<OutgoingRequest> outgoingRequests;
+
+            /**
+             * Flag indicating that the last connection attempt failed.  Additional connections are not opened while
+             * this flag is set and other connections remain open.
+             */
+            bool connectionAttemptFailed;
+    };
+}
+
+#endif
@@ -0,0 +1,141 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref RestApiOutV1::PipelinedNetworkReply class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project inerest_api_out_v1 */
+
+#ifndef REST_API_OUT_V1_PIPELINED_NETWORK_REPLY_H
+#define REST_API_OUT_V1_PIPELINED_NETWORK_REPLY_H
+
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+
+#include "rest_api_out_v1_common.h"
+
+namespace RestApiOutV1 {
+    class PipelinedHttpClient;
+
+    /**
+     * Network reply used by the \ref RestApiOutV1::PipelinedHttpClient and \ref RestApiOutV1::LoopbackTransport
+     * classes.  The reply is populated by the transport once the complete response is available.
+     */
+    class REST_API_OUT_V1_PUBLIC_API PipelinedNetworkReply:public QNetworkReply {
+        friend class PipelinedHttpClient;
+        friend class LoopbackTransport;
+
+        Q_OBJECT
+
+        public:
+            /**
+             * Type used to hold a list of response headers.
+             */
+            typedef QList<QPair<QByteArray, QByteArray>> HeaderList;
+
+            /**
+             * Constructor
+             *
+             * \param[in] request The request this reply is tied to.
+             *
+             * \param[in] parent  Pointer to the parent object.
+             */
+            PipelinedNetworkReply(const QNetworkRequest& request, QObject* parent = nullptr);
+
+            ~PipelinedNetworkReply() override;
+
+            /**
+             * Method you can use to abort the request.  If the request has already been sent, the response is
+             * discarded when it arrives.
+             */
+            void abort() override;
+
+            /**
+             * Method you can use to determine the number of bytes available to be read.
+             *
+             * \return Returns the number of bytes available.
+             */
+            qint64 bytesAvailable() const override;
+
+            /**
+             * Method you can use to determine if this device is sequential.
+             *
+             * \return Returns true.
+             */
+            bool isSequential() const override;
+
+        protected:
+            /**
+             * Method that reads data from the response body.
+             *
+             * \param[in] data    Buffer to receive the data.
+             *
+             * \param[in] maxSize The maximum number of bytes to read.
+             *
+             * \return Returns the number of bytes read.
+             */
+            qint64 readData(char* data, qint64 maxSize) override;
+
+        private:
+            /**
+             * Method that populates this reply from a received response.  The finished signal is emitted from the
+             * event loop.
+             *
+             * \param[in] statusCode   The HTTP status code.
+             *
+             * \param[in] reasonPhrase The HTTP reason phrase.
+             *
+             * \param[in] headers      The response headers.
+             *
+             * \param[in] body         The response body.
+             */
+            void setResponse(
+                int               statusCode,
+                const QByteArray& reasonPhrase,
+                const HeaderList& headers,
+                const QByteArray& body
+            );
+
+            /**
+             * Method that marks this reply as failed.  The finished signal is emitted from the event loop.
+             *
+             * \param[in] networkError The error to report.
+             *
+             * \param[in] errorString  A description of the error.
+             */
+            void setFailed(QNetworkReply::NetworkError networkError, const QString& errorString);
+
+            /**
+             * The response body.
+             */
+            QByteArray responseBody;
+
+            /**
+             * The offset of the next byte to be read from the response body.
+             */
+            qint64 readOffset;
+    };
+}
+
+#endif
@@ -28,20 +28,43 @@
 #include <QObject>
 #include <QString>
 #include <QUrl>
+#include <QPointer>
 #include <QMutex>
+#include <QList>
+#include <QHash>
+#include <QMap>
+#include <QSet>
+#include <QTimer>
+#include <QElapsedTimer>
 #include <QNetworkAccessManager>
 #include <QNetworkRequest>
 #include <QNetworkReply>
 
+#ifndef QT_NO_SSL
+    #include <QSslConfiguration>
+#endif
+
+#include <QHttp2Configuration>
+
 #include <cstdint>
+#include <atomic>
+#include <functional>
 
 #include "rest_api_out_v1_common.h"
+#include "rest_api_out_v1_time_delta_estimator.h"
+#include "rest_api_out_v1_mpsc_queue.h"
+
+class QThread;
 
 namespace RestApiOutV1 {
     class InesonicRestHandlerBase;
+    class ServerGroup;
+    class PipelinedHttpClient;
+    class Transport;
 
     /**
-     * Class that provides support for sending messages to generic Inesonic web hooks.
+     * Class that provides support for sending messages to generic Inesonic web hooks.  Unless noted otherwise,
+     * methods used to configure the server must be called from the thread the server lives on.
      */
     class REST_API_OUT_V1_PUBLIC_API Server:public QObject {
         friend class InesonicRestHandlerBase;
@@ -65,6 +88,22 @@ namespace RestApiOutV1 {
 
                     virtual ~RestApi();
 
+                    /**
+                     * Method you can use to route this REST API's requests across a group of servers.  When set, a
+                     * server is selected from the group for each new request.
+                     *
+                     * \param[in] newServerGroup The server group to use.  A null pointer disables routing and leaves
+                     *                           the REST API tied to its most recently selected server.
+                     */
+                    void setServerGroup(ServerGroup* newServerGroup);
+
+                    /**
+                     * Method you can use to obtain the server group used to route this REST API's requests.
+                     *
+                     * \return Returns the current server group.  A null pointer is returned if routing is disabled.
+                     */
+                    ServerGroup* serverGroup() const;
+
                 protected:
                     /**
                      * Method you can use to access the underlying server instance.
@@ -89,6 +128,31 @@ namespace RestApiOutV1 {
                      */
                     void updateTimeDelta();
 
+                    /**
+                     * Method you should call before building a new request.  If a server group is in use, the method
+                     * selects the server that should receive the request.
+                     */
+                    void selectServer();
+
+                    /**
+                     * Method you should call when a response is received from the server.  The method allows the
+                     * server to track latency and error rate and, when passive tracking is enabled, to track the time
+                     * delta from the response headers.
+                     *
+                     * \param[in] reply   The received network reply.
+                     *
+                     * \param[in] latency The time between sending the request and receiving the response, in mSec.
+                     */
+                    void reportResponse(const QNetworkReply* reply, long long latency);
+
+                    /**
+                     * Method you should call when the server rejects a request due to an authentication failure.
+                     *
+                     * \param[in] signatureMargin The distance between the expected arrival time of the request
+                     *                            and the nearest signing window boundary, in mSec.
+                     */
+                    void reportAuthenticationFailure(long long signatureMargin);
+
                 protected:
                     /**
                      * Method that is triggered when the timestamp is successfully updated. The default implementation
@@ -104,9 +168,15 @@ namespace RestApiOutV1 {
 
                 private:
                     /**
-                     * The underlying server instance.
+                     * The underlying server instance.  Tracked so that we don't touch the server if it's destroyed
+                     * before this REST API.
                      */
-                    Server* currentServer;
+                    QPointer<Server> currentServer;
+
+                    /**
+                     * The server group used to select servers.
+                     */
+                    QPointer<ServerGroup> currentServerGroup;
             };
 
             /**
@@ -124,6 +194,85 @@ namespace RestApiOutV1 {
              */
             static const unsigned secretLength;
 
+            /**
+             * The default maximum age of a cached time delta, in seconds.
+             */
+            static const unsigned long defaultTimeDeltaCacheMaximumAge;
+
+            /**
+             * The default lower bound on the adaptive concurrency limit.
+             */
+            static const unsigned long defaultMinimumConcurrencyLimit;
+
+            /**
+             * The default upper bound on the adaptive concurrency limit.
+             */
+            static const unsigned long defaultMaximumConcurrencyLimit;
+
+            /**
+             * Ticket returned by \ref schedule when a request is rejected because too many requests are waiting.
+             */
+            static const unsigned long long rejectedTicket;
+
+            /**
+             * Type used for work submitted to the server's thread.
+             */
+            typedef std::function<void()> Task;
+
+            /**
+             * Type used to deliver work to a caller selected thread or thread pool.  The executor receives the task
+             * to be run.
+             */
+            typedef std::function<void(const Task&)> Executor;
+
+            /**
+             * Type used to issue a scheduled request.  The function sends the request and returns the resulting
+             * reply.  A null pointer can be returned if the request is no longer needed.
+             */
+            typedef std::function<QNetworkReply*()> Issuer;
+
+            /**
+             * Enumeration of supported methods used to spread requests across a pool of network access managers.
+             */
+            enum class ShardingPolicy {
+                /**
+                 * Requests are assigned to the managers in the pool in turn.
+                 */
+                ROUND_ROBIN,
+
+                /**
+                 * Requests are assigned to a manager based on a hash of the endpoint so that requests to the same
+                 * endpoint reuse the same connections.
+                 */
+                BY_ENDPOINT
+            };
+
+            /**
+             * Enumeration of request priority classes.  Scheduled requests are issued in the order the classes are
+             * listed.
+             */
+            enum class Priority {
+                /**
+                 * Latency critical control plane requests.
+                 */
+                CONTROL,
+
+                /**
+                 * Requests on behalf of an interactive user.
+                 */
+                INTERACTIVE,
+
+                /**
+                 * Ordinary requests.
+                 */
+                NORMAL,
+
+                /**
+                 * Bulk transfers and telemetry that can tolerate delay.
+                 */
+                BULK
+            };
+
             /**
              * Constructor
              *
@@ -163,6 +312,59 @@ namespace RestApiOutV1 {
                 QObject*               parent = Q_NULLPTR
             );
 
+            /**
+             * Constructor.  The time delta snapshot in the cache file, if present and recent, is loaded before the
+             * constructor returns so that the first requests are signed using it.  See \ref setTimeDeltaCacheFile.
+             *
+             * \param[in] networkAccessManager The network settings manager.
+             *
+             * \param[in] serverSchemeAndHost  The server's scheme and host.
+             *
+             * \param[in] timeDeltaSlug        The URL used to determine time deltas.
+             *
+             * \param[in] timeDeltaCacheFile   The file used to hold the time delta snapshot.
+             *
+             * \param[in] maximumAge           The maximum age of a usable snapshot, in seconds.
+             *
+             * \param[in] parent               Pointer to the parent object.
+             */
+            Server(
+                QNetworkAccessManager* networkAccessManager,
+                const QUrl&            serverSchemeAndHost,
+                const QString&         timeDeltaSlug,
+                const QString&         timeDeltaCacheFile,
+                unsigned long          maximumAge,
+                QObject*               parent = Q_NULLPTR
+            );
+
+            /**
+             * Constructor.  The time delta snapshot in the cache file, if present and recent, is loaded before the
+             * constructor returns so that the first requests are signed using it.  See \ref setTimeDeltaCacheFile.
+             *
+             * \param[in] networkAccessManager The network settings manager.
+             *
+             * \param[in] serverSchemeAndHost  The server's scheme and host.
+             *
+             * \param[in] defaultSecret        The default secret to use for requests.
+             *
+             * \param[in] timeDeltaSlug        The URL used to determine time deltas.
+             *
+             * \param[in] timeDeltaCacheFile   The file used to hold the time delta snapshot.
+             *
+             * \param[in] maximumAge           The maximum age of a usable snapshot, in seconds.
+             *
+             * \param[in] parent               Pointer to the parent object.
+             */
+            Server(
+                QNetworkAccessManager* networkAccessManager,
+                const QUrl&            serverSchemeAndHost,
+                const QByteArray&      defaultSecret,
+                const QString&         timeDeltaSlug,
+                const QString&         timeDeltaCacheFile,
+                unsigned long          maximumAge,
+                QObject*               parent = Q_NULLPTR
+            );
+
             ~Server() override;
 
             /**
@@ -179,6 +381,205 @@ namespace RestApiOutV1 {
              */
             QNetworkAccessManager* networkAccessManager() const;
 
+            /**
+             * Method you can use to set the number of network access managers used to send requests.  Each network
+             * access manager limits the number of parallel connections to a host.  Using a pool of managers raises
+             * that limit.  The pool always includes the network access manager provided to the constructor.  Time
+             * delta requests always use that manager.
+             *
+             * Additional managers are owned by this server.  Managers removed from the pool no longer receive new
+             * requests and are released once their outstanding replies finish.
+             *
+             * \param[in] newPoolSize The new pool size.  A value of 0 is treated as 1.
+             */
+            void setNetworkAccessManagerPoolSize(unsigned newPoolSize);
+
+            /**
+             * Method you can use to determine the number of network access managers used to send requests.
+             *
+             * \return Returns the pool size.
+             */
+            unsigned networkAccessManagerPoolSize() const;
+
+            /**
+             * Method you can use to set how requests are spread across the network access manager pool.
+             *
+             * \param[in] newShardingPolicy The new sharding policy.
+             */
+            void setShardingPolicy(ShardingPolicy newShardingPolicy);
+
+            /**
+             * Method you can use to determine how requests are spread across the network access manager pool.
+             *
+             * \return Returns the current sharding policy.
+             */
+            ShardingPolicy shardingPolicy() const;
+
+            /**
+             * Method you can use to enable or disable the pipelined transport.  When enabled, requests issued through
+             * \ref post are sent over a small number of persistent, pipelined, HTTP/1.1 connections rather than
+             * through the network access manager.  Time delta requests always use the network access manager unless a
+             * custom transport is set.
+             *
+             * The pipelined transport is intended for bulk traffic to a single trusted host.  See
+             * \ref RestApiOutV1::PipelinedHttpClient for details.
+             *
+             * \param[in] nowEnabled If true, the pipelined transport will be enabled.  If false, the pipelined
+             *                       transport will be disabled.
+             */
+            void setPipelinedTransportEnabled(bool nowEnabled = true);
+
+            /**
+             * Method you can use to disable or enable the pipelined transport.
+             *
+             * \param[in] nowDisabled If true, the pipelined transport will be disabled.  If false, the pipelined
+             *                        transport will be enabled.
+             */
+            void setPipelinedTransportDisabled(bool nowDisabled = true);
+
+            /**
+             * Method you can use to determine if the pipelined transport is enabled.
+             *
+             * \return Returns true if the pipelined transport is enabled.  Returns false if the pipelined transport
+             *         is disabled.
+             */
+            bool pipelinedTransportEnabled() const;
+
+            /**
+             * Method you can use to determine if the pipelined transport is disabled.
+             *
+             * \return Returns true if the pipelined transport is disabled.  Returns false if the pipelined transport
+             *         is enabled.
+             */
+            bool pipelinedTransportDisabled() const;
+
+            /**
+             * Method you can use to obtain the pipelined HTTP client, to adjust the number of connections or the
+             * pipeline depth.
+             *
+             * \return Returns the pipelined HTTP client.  A null pointer is returned if the pipelined transport is
+             *         disabled.
+             */
+            PipelinedHttpClient* pipelinedHttpClient() const;
+
+            /**
+             * Method you can use to route requests through a custom transport, such as a
+             * \ref RestApiOutV1::LocalSocketTransport or a \ref RestApiOutV1::LoopbackTransport.  When set, the
+             * transport is used for all requests, including time delta requests, in place of the pipelined transport
+             * and the network access manager.
+             *
+             * \param[in] newTransport The transport to be used.  The transport is not owned by this server and must
+             *                         live in the server's thread.  A null pointer restores the default behavior.
+             */
+            void setTransport(Transport* newTransport);
+
+            /**
+             * Method you can use to obtain the custom transport.
+             *
+             * \return Returns the custom transport.  A null pointer is returned if no custom transport is set.
+             */
+            Transport* transport() const;
+
+            /**
+             * Method you can use to enable or disable HTTP/2.  When enabled, requests sent through the network access
+             * manager, including time delta requests, are multiplexed over a single HTTP/2 connection per manager.
+             * For https servers, HTTP/2 is negotiated during the TLS handshake.  For http servers, cleartext HTTP/2
+             * (h2c) is used with prior knowledge, so the server must accept HTTP/2 without an upgrade.
+             *
+             * HTTP/2 does not apply to the pipelined transport or to a custom transport.  While either is in use, the
+             * HTTP/2 settings only apply to time delta requests.
+             *
+             * \param[in] nowEnabled If true, HTTP/2 will be enabled.  If false, HTTP/2 will be disabled.
+             *
+             * \return Returns true on success.  Returns false if HTTP/2 was enabled while the pipelined transport or
+             *         a custom transport is in use.  The setting is kept and applies once the default transport is
+             *         restored.
+             */
+            bool setHttp2Enabled(bool nowEnabled = true);
+
+            /**
+             * Method you can use to disable or enable HTTP/2.
+             *
+             * \param[in] nowDisabled If true, HTTP/2 will be disabled.  If false, HTTP/2 will be enabled.
+             *
+             * \return Returns true on success.  Returns false if HTTP/2 was enabled while the pipelined transport or
+             *         a custom transport is in use.  The setting is kept and applies once the default transport is
+             *         restored.
+             */
+            bool setHttp2Disabled(bool nowDisabled = true);
+
+            /**
+             * Method you can use to determine if HTTP/2 is enabled.
+             *
+             * \return Returns true if HTTP/2 is enabled.  Returns false if HTTP/2 is disabled.
+             */
+            bool http2Enabled() const;
+
+            /**
+             * Method you can use to determine if HTTP/2 is disabled.
+             *
+             * \return Returns true if HTTP/2 is disabled.  Returns false if HTTP/2 is enabled.
+             */
+            bool http2Disabled() const;
+
+            /**
+             * Method you can use to set the HTTP/2 receive window for each stream.
+             *
+             * \param[in] newWindowSize The new window size, in bytes.  A value of 0 selects the Qt default.
+             *
+             * \return Returns true on success.  Returns false if Qt rejected the window size, in which case the
+             *         previous setting is kept.  Also returns false, keeping the new setting, if the pipelined
+             *         transport or a custom transport is in use as the setting then only applies to time delta
+             *         requests.
+             */
+            bool setHttp2StreamReceiveWindowSize(unsigned newWindowSize);
+
+            /**
+             * Method you can use to determine the HTTP/2 receive window for each stream.
+             *
+             * \return Returns the stream receive window size, in bytes.  A value of 0 indicates the Qt default.
+             */
+            unsigned http2StreamReceiveWindowSize() const;
+
+            /**
+             * Method you can use to set the HTTP/2 receive window for the connection as a whole.
+             *
+             * \param[in] newWindowSize The new window size, in bytes.  A value of 0 selects the Qt default.
+             *
+             * \return Returns true on success.  Returns false if Qt rejected the window size, in which case the
+             *         previous setting is kept.  Also returns false, keeping the new setting, if the pipelined
+             *         transport or a custom transport is in use as the setting then only applies to time delta
+             *         requests.
+             */
+            bool setHttp2SessionReceiveWindowSize(unsigned newWindowSize);
+
+            /**
+             * Method you can use to determine the HTTP/2 receive window for the connection as a whole.
+             *
+             * \return Returns the session receive window size, in bytes.  A value of 0 indicates the Qt default.
+             */
+            unsigned http2SessionReceiveWindowSize() const;
+
+            /**
+             * Method you can use to set the largest HTTP/2 frame this client will accept.
+             *
+             * \param[in] newFrameSize The new maximum frame size, in bytes.  Valid values are between 16384 and
+             *                         16777215.  A value of 0 selects the Qt default.
+             *
+             * \return Returns true on success.  Returns false if the frame size is out of range, in which case the
+             *         previous setting is kept.  Also returns false, keeping the new setting, if the pipelined
+             *         transport or a custom transport is in use as the setting then only applies to time delta
+             *         requests.
+             */
+            bool setHttp2MaximumFrameSize(unsigned newFrameSize);
+
+            /**
+             * Method you can use to determine the largest HTTP/2 frame this client will accept.
+             *
+             * \return Returns the maximum frame size, in bytes.  A value of 0 indicates the Qt default.
+             */
+            unsigned http2MaximumFrameSize() const;
+
             /**
              * Method you can use to set the server's scheme and host.  Value should be of the form
              * "https://myserver.com".
@@ -239,120 +640,1065 @@ namespace RestApiOutV1 {
             /**
              * Method you can use to obtain the current measured time delta.
              *
-             * \return Returns the current measured time delta.
+             * \return Returns the current measured time delta, in seconds.
              */
             long long timeDelta();
 
             /**
-             * Method you can use to issue a post request.
+             * Method you can use to obtain the current measured time delta with millisecond resolution.
              *
-             * \param[in] request The network request to be sent.
-             *
-             * \param[in] payload The payload to be sent.
-             *
-             * \return Returns a newly created network reply instance.
+             * \return Returns the current measured time delta, in mSec.
              */
-            inline QNetworkReply* post(const QNetworkRequest& request, const QByteArray& payload) {
-                return currentNetworkAccessManager->post(request, payload);
-            }
+            long long timeDeltaMilliseconds();
 
-        signals:
             /**
-             * Signal you can bind to in order to receive notification that the server time delta has changed.
+             * Method you can use to obtain the uncertainty in the current time delta, as reported by the round trip
+             * time compensated estimator used for explicit time delta requests.
+             *
+             * \return Returns the uncertainty in the time delta, in mSec.  A negative value is returned if no
+             *         explicit time delta request has completed.
              */
-            void timeDeltaChanged();
+            long long timeDeltaUncertainty();
 
             /**
-             * Signal you can bind to in order to receive notification that the server time delta update failed.
+             * Method you can use to obtain the round trip time of the time delta measurement currently in use.
+             *
+             * \return Returns the round trip time, in mSec.  A negative value is returned if no explicit time delta
+             *         request has completed.
              */
-            void timeDeltaUpdateFailed();
+            long long timeDeltaRoundTripTime();
 
-        private slots:
             /**
-             * Slot that is triggered when a reply or error occurs for an outbound message.
+             * Method you can use to obtain the expected one-way transit time to the server.  The value is used to
+             * select the signing window that will be current when a request arrives at the server.  The value is
+             * derived from the round trip time of explicit time delta requests.
+             *
+             * \return Returns the expected transit time, in mSec.
              */
-            void responseReceived();
+            long long expectedTransitTime() const;
 
-        private:
-            friend class RestApi;
+            /**
+             * Method you can use to determine the number of requests signed against this server.
+             *
+             * \return Returns the number of signed requests.
+             */
+            unsigned long long signedRequests() const;
 
             /**
-             * Method you can call to trigger the time delta to be updated.
+             * Method you can use to determine the number of requests rejected by the server due to authentication
+             * failures.
              *
-             * \param[in] restApi The REST API making this request.
+             * \return Returns the number of authentication failures.
              */
-            void updateTimeDelta(RestApi* restApi);
+            unsigned long long authenticationFailures() const;
 
             /**
-             * Method you can call to check if a timestamp update is in progress.  If an update is in progress then
-             * the provided REST API instance will be included on a list to receive a callback.
+             * Method you can use to determine the number of authentication failures where the request was signed
+             * close enough to a signing window boundary that the failure was likely due to the request arriving in
+             * the next window rather than due to an inaccurate time delta.
              *
-             * \param[in] restApi The REST API making this request.
+             * \return Returns the number of signing window boundary misses.
+             */
+            unsigned long long signingWindowBoundaryMisses() const;
+
+            /**
+             * Method you can use to obtain the smoothed latency of requests sent to this server.
              *
-             * \return Returns true if the timestamp is believed to be accurate.  Returns false if the timestamp is not
-             *         accurate.
+             * \return Returns the exponentially weighted moving average latency, in mSec.  A negative value is
+             *         returned if no responses have been received.
              */
-            bool checkTimestamp(RestApi* restApi);
+            double averageLatency() const;
 
             /**
-             * Value indicating the number of allowed retries.
+             * Method you can use to obtain the smoothed rate of failed requests to this server.  Failures include
+             * connection errors, timeouts and server side errors but exclude authentication failures and other
+             * errors caused by the request itself.
+             *
+             * \return Returns the exponentially weighted moving average error rate, between 0 and 1.
              */
-            static constexpr unsigned numberRetries = 2;
+            double errorRate() const;
 
             /**
-             * Method that issues a new time-delta request.
+             * Method you can use to obtain the number of responses used to calculate the latency and error rate.
+             *
+             * \return Returns the number of responses received since the statistics were last reset.
              */
-            void issueTimeDeltaRequest();
+            unsigned long long numberResponses() const;
 
             /**
-             * Method that parses the received JSON response.
+             * Method you can use to obtain a latency percentile over recent requests to this server.  Requests that
+             * failed due to connection errors are excluded.
              *
-             * \param[in] document The received JSON document.
+             * \param[in] percentile The desired percentile, between 0 and 100.
              *
-             * \return Returns true on success.  Returns false on error.
+             * \return Returns the latency at the requested percentile, in mSec.  A negative value is returned if no
+             *         responses have been received.
              */
-            bool parseResponse(const QJsonDocument& document);
+            long long latencyPercentile(double percentile) const;
 
             /**
-             * The network access manager to be used.
+             * Method you can use to reset the latency and error rate statistics.
+             *
+             * \param[in] initialLatency The latency used to seed the smoothed latency, in mSec.  A negative value
+             *                           leaves the server with no latency data.
              */
-            QNetworkAccessManager* currentNetworkAccessManager;
+            void resetStatistics(double initialLatency = -1);
 
             /**
-             * The current server URL and scheme.
+             * Method you can use to configure periodic background updates of the time delta.  Background updates
+             * allow the time delta to track clock drift before requests start failing authentication.
+             *
+             * \param[in] newInterval The nominal interval between updates, in mSec.  A value of 0 disables
+             *                        background updates.
+             *
+             * \param[in] newJitter   The maximum random adjustment to apply to each interval, in mSec.  Jitter
+             *                        prevents many clients from synchronizing against the server in lock-step.
              */
-            QUrl currentSchemeAndHost;
+            void setTimeDeltaRefreshInterval(unsigned long newInterval, unsigned long newJitter = 0);
 
             /**
-             * The current time delta slug.
+             * Method you can use to determine the nominal interval between background time delta updates.
+             *
+             * \return Returns the nominal refresh interval, in mSec.  A value of 0 indicates that background
+             *         updates are disabled.
              */
-            QString currentTimeDeltaSlug;
+            unsigned long timeDeltaRefreshInterval() const;
 
             /**
-             * The current default secret to use for web requests.
+             * Method you can use to determine the jitter applied to background time delta updates.
+             *
+             * \return Returns the maximum jitter, in mSec.
              */
-            QByteArray currentDefaultSecret;
+            unsigned long timeDeltaRefreshJitter() const;
 
             /**
-             * The current user agent string.
+             * Method you can use to pace how REST API instances waiting on a time delta update are resumed.  By
+             * default, all waiting instances are resumed at once which, after an outage, can cause a burst of
+             * simultaneous requests.  Pacing releases the waiting instances in bounded batches instead.  Requests
+             * held within each \ref InesonicRestHandlerBase instance are released using the same batch size and
+             * interval.
+             *
+             * \param[in] newBatchSize The maximum number of instances to resume at once.  A value of 0 resumes all
+             *                         waiting instances at once.
+             *
+             * \param[in] newInterval  The delay between batches, in mSec.
              */
-            QString currentUserAgent;
+            void setResumePacing(unsigned newBatchSize, unsigned long newInterval);
 
             /**
-             * The last measured time delta.
+             * Method you can use to determine the maximum number of REST API instances resumed at once after a time
+             * delta update.
+             *
+             * \return Returns the resume batch size.  A value of 0 indicates that all instances are resumed at once.
              */
-            long long currentTimeDelta;
+            unsigned resumeBatchSize() const;
 
             /**
-             * Mutex used to prevent bad concurrent access.
+             * Method you can use to determine the delay between batches of resumed REST API instances.
+             *
+             * \return Returns the delay between batches, in mSec.
              */
-            QMutex requestMutex;
+            unsigned long resumeInterval() const;
+
+            /**
+             * Method you can use to enable or disable passive time delta tracking.  When enabled, the time delta
+             * will be updated from the HTTP Date header of normal responses.  Outliers, such as stale cached
+             * responses, are rejected by taking the median of recent samples.  You should only enable this mode if
+             * the server's HTTP Date headers are generated from the same clock used to validate requests.
+             *
+             * \param[in] nowEnabled If true, passive tracking will be enabled.  If false, passive tracking will be
+             *                       disabled.
+             */
+            void setPassiveTimeDeltaTrackingEnabled(bool nowEnabled = true);
+
+            /**
+             * Method you can use to disable or enable passive time delta tracking.
+             *
+             * \param[in] nowDisabled If true, passive tracking will be disabled.  If false, passive tracking will be
+             *                        enabled.
+             */
+            void setPassiveTimeDeltaTrackingDisabled(bool nowDisabled = true);
+
+            /**
+             * Method you can use to determine if passive time delta tracking is enabled.
+             *
+             * \return Returns true if passive time delta tracking is enabled.  Returns false if passive time delta
+             *         tracking is disabled.
+             */
+            bool passiveTimeDeltaTrackingEnabled() const;
+
+            /**
+             * Method you can use to determine if passive time delta tracking is disabled.
+             *
+             * \return Returns true if passive time delta tracking is disabled.  Returns false if passive time delta
+             *         tracking is enabled.
+             */
+            bool passiveTimeDeltaTrackingDisabled() const;
+
+            /**
+             * Method you can use to specify a file used to persist the time delta across process restarts.  The
+             * snapshot in the file, if present and recent, is loaded immediately and a background time delta update
+             * is triggered to confirm it.  The file is rewritten after every successful time delta update.  You
+             * should call this method immediately after constructing the server, or use one of the constructors that
+             * accept a cache file.
+             *
+             * The snapshot records the relationship between the wall clock and the monotonic clock so that a step
+             * of the local wall clock, since the snapshot was taken, can be corrected for.
+             *
+             * \param[in] newFilename   The file used to hold the time delta snapshot.  An empty string disables
+             *                          persistence.
+             *
+             * \param[in] maximumAge    The maximum age of a usable snapshot, in seconds.
+             *
+             * \return Returns true if a usable snapshot was loaded.  Returns false if no usable snapshot was found.
+             */
+            bool setTimeDeltaCacheFile(
+                const QString& newFilename,
+                unsigned long  maximumAge = defaultTimeDeltaCacheMaximumAge
+            );
+
+            /**
+             * Method you can use to determine the file used to persist the time delta.
+             *
+             * \return Returns the time delta cache file.  An empty string is returned if persistence is disabled.
+             */
+            const QString& timeDeltaCacheFile() const;
+
+            /**
+             * Method you can use to issue a post request.
+             *
+             * \param[in] request The network request to be sent.
+             *
+             * \param[in] payload The payload to be sent.
+             *
+             * \return Returns a newly created network reply instance.
+             */
+            QNetworkReply* post(const QNetworkRequest& request, const QByteArray& payload);
+
+            /**
+             * Method you can use to set the maximum number of scheduled requests that can be outstanding at once.
+             * Each server talks to a single host so the limit applies per host.  Requests over the limit are held
+             * by \ref schedule until an outstanding request finishes.  Time delta requests are never held and are not
+             * counted against the limit.
+             *
+             * \param[in] newMaximumInFlightRequests The new limit.  A value of 0 disables the limit.
+             */
+            void setMaximumInFlightRequests(unsigned long newMaximumInFlightRequests);
+
+            /**
+             * Method you can use to determine the maximum number of scheduled requests that can be outstanding at
+             * once.
+             *
+             * \return Returns the current limit.  A value of 0 indicates no limit.
+             */
+            unsigned long maximumInFlightRequests() const;
+
+            /**
+             * Method you can use to determine the number of scheduled requests currently outstanding.
+             *
+             * \return Returns the number of outstanding scheduled requests.
+             */
+            unsigned long numberInFlightRequests() const;
+
+            /**
+             * Method you can use to determine the number of scheduled requests waiting to be issued.
+             *
+             * \return Returns the number of waiting requests.
+             */
+            unsigned long numberScheduledRequests() const;
+
+            /**
+             * Method you can use to enable or disable adaptive concurrency control.  When enabled, the number of
+             * outstanding scheduled requests is limited by a value that tracks the capacity of the host.  The limit
+             * grows by one each time a full limit's worth of requests completes promptly and shrinks by a fixed
+             * fraction when requests fail with host errors, are throttled, or take much longer than the lowest
+             * recent latency.  Any limit set through \ref setMaximumInFlightRequests still applies.
+             *
+             * \param[in] nowEnabled If true, adaptive concurrency control will be enabled.  If false, adaptive
+             *                       concurrency control will be disabled.
+             */
+            void setAdaptiveConcurrencyEnabled(bool nowEnabled = true);
+
+            /**
+             * Method you can use to disable or enable adaptive concurrency control.
+             *
+             * \param[in] nowDisabled If true, adaptive concurrency control will be disabled.  If false, adaptive
+             *                        concurrency control will be enabled.
+             */
+            void setAdaptiveConcurrencyDisabled(bool nowDisabled = true);
+
+            /**
+             * Method you can use to determine if adaptive concurrency control is enabled.
+             *
+             * \return Returns true if adaptive concurrency control is enabled.  Returns false if adaptive concurrency
+             *         control is disabled.
+             */
+            bool adaptiveConcurrencyEnabled() const;
+
+            /**
+             * Method you can use to determine if adaptive concurrency control is disabled.
+             *
+             * \return Returns true if adaptive concurrency control is disabled.  Returns false if adaptive
+             *         concurrency control is enabled.
+             */
+            bool adaptiveConcurrencyDisabled() const;
+
+            /**
+             * Method you can use to set the bounds on the adaptive concurrency limit.
+             *
+             * \param[in] minimumLimit The lowest allowed limit.  A value of 0 is treated as 1.
+             *
+             * \param[in] maximumLimit The highest allowed limit.  Values below the minimum are treated as the
+             *                         minimum.
+             */
+            void setConcurrencyLimitBounds(unsigned long minimumLimit, unsigned long maximumLimit);
+
+            /**
+             * Method you can use to obtain the lower bound on the adaptive concurrency limit.
+             *
+             * \return Returns the lowest allowed limit.
+             */
+            unsigned long minimumConcurrencyLimit() const;
+
+            /**
+             * Method you can use to obtain the upper bound on the adaptive concurrency limit.
+             *
+             * \return Returns the highest allowed limit.
+             */
+            unsigned long maximumConcurrencyLimit() const;
+
+            /**
+             * Method you can use to obtain the current adaptive concurrency limit.
+             *
+             * \return Returns the current limit.  The value is only meaningful while adaptive concurrency control is
+             *         enabled.
+             */
+            unsigned long concurrencyLimit() const;
+
+            /**
+             * Method you can use to set the maximum number of requests that can wait to be issued.  Requests
+             * scheduled beyond this limit are rejected.
+             *
+             * \param[in] newMaximumScheduledRequests The new limit.  A value of 0 allows any number of requests to
+             *                                        wait.
+             */
+            void setMaximumScheduledRequests(unsigned long newMaximumScheduledRequests);
+
+            /**
+             * Method you can use to determine the maximum number of requests that can wait to be issued.
+             *
+             * \return Returns the current limit.  A value of 0 indicates no limit.
+             */
+            unsigned long maximumScheduledRequests() const;
+
+            /**
+             * Method you can use to limit the rate of requests sent to an endpoint.  Requests are drawn from a token
+             * bucket and are held, rather than sent, while the bucket is empty.
+             *
+             * \param[in] endpoint          The endpoint to be limited.
+             *
+             * \param[in] requestsPerSecond The sustained request rate.  A value of 0 or less removes the limit.
+             *
+             * \param[in] burstSize         The number of requests that can be sent back to back after an idle
+             *                              period.  Values below 1 are treated as 1.
+             */
+            void setEndpointRateLimit(const QString& endpoint, double requestsPerSecond, double burstSize = 1.0);
+
+            /**
+             * Method you can use to limit the rate of requests signed with a secret.  Requests are drawn from a token
+             * bucket and are held, rather than sent, while the bucket is empty.  Requests that are subject to both
+             * an endpoint and a secret limit must satisfy both.
+             *
+             * \param[in] secret            The secret to be limited.  An empty value selects the current default
+             *                              secret.
+             *
+             * \param[in] requestsPerSecond The sustained request rate.  A value of 0 or less removes the limit.
+             *
+             * \param[in] burstSize         The number of requests that can be sent back to back after an idle
+             *                              period.  Values below 1 are treated as 1.
+             */
+            void setSecretRateLimit(const QByteArray& secret, double requestsPerSecond, double burstSize = 1.0);
+
+            /**
+             * Method you can use to determine the number of requests that can be sent to an endpoint right now.
+             *
+             * \param[in] endpoint The endpoint to check.
+             *
+             * \return Returns the number of available tokens.  The value can be fractional.  A negative value is
+             *         returned if the endpoint is not rate limited.
+             */
+            double remainingEndpointBudget(const QString& endpoint) const;
+
+            /**
+             * Method you can use to determine the number of requests that can be signed with a secret right now.
+             *
+             * \param[in] secret The secret to check.  An empty value selects the current default secret.
+             *
+             * \return Returns the number of available tokens.  The value can be fractional.  A negative value is
+             *         returned if the secret is not rate limited.
+             */
+            double remainingSecretBudget(const QByteArray& secret) const;
+
+            /**
+             * Method you can use to obtain the key used to identify a secret for rate limiting.  The key is a digest
+             * of the secret so the secret itself is not retained.
+             *
+             * \param[in] secret The secret.
+             *
+             * \return Returns the rate limiting key.
+             */
+            static QByteArray rateLimitKey(const QByteArray& secret);
+
+            /**
+             * Method you can use to schedule a request.  The request is issued immediately if the in-flight limit
+             * and rate limits allow.  Otherwise the request is held until it can be sent.  Waiting requests are
+             * issued in priority order.  Within a priority class, sources take turns so that one busy source can not
+             * starve the others.  A request held by a rate limit does not block requests that are not subject to
+             * that limit.  This method must be called from the thread this server lives in.
+             *
+             * \param[in] priority  The request's priority class.
+             *
+             * \param[in] source    Value identifying the source of the request, typically the REST API instance.
+             *
+             * \param[in] issuer    Function that sends the request.
+             *
+             * \param[in] endpoint  The request endpoint, used for rate limiting.
+             *
+             * \param[in] secretKey The key, from \ref rateLimitKey, of the secret used to sign the request.  An empty
+             *                      value indicates the default secret.
+             *
+             * \return Returns a ticket you can use to cancel the request.  A value of 0 is returned if the request
+             *         was issued immediately.  The value \ref rejectedTicket is returned if the request was rejected.
+             */
+            unsigned long long schedule(
+                Priority          priority,
+                const void*       source,
+                const Issuer&     issuer,
+                const QString&    endpoint = QString(),
+                const QByteArray& secretKey = QByteArray()
+            );
+
+            /**
+             * Method you can use to cancel a request that is waiting to be issued.
+             *
+             * \param[in] ticket The ticket returned by \ref schedule.
+             *
+             * \return Returns true if the request was canceled.  Returns false if the ticket is not waiting.
+             */
+            bool cancelScheduled(unsigned long long ticket);
+
+            /**
+             * Method you can use to specify a file used to persist TLS session tickets across process restarts.
+             * When set, the TLS session ticket from the file, if any, is offered to the server so that a restarted
+             * process can resume the prior session rather than performing a full handshake.  The file is updated
+             * whenever a new encrypted connection is established.
+             *
+             * Note that the file contents are sensitive and should be protected in the same way as the secrets.  The
+             * ticket is sufficient to resume the session.  The file is written so that only the owner can read or
+             * write it; you should also place it in a directory that is not accessible to other users.
+             *
+             * \param[in] newFilename The file used to hold the TLS session ticket.  An empty string disables the
+             *                        cache.
+             *
+             * \return Returns true if a session ticket was loaded.  Returns false if no session ticket was loaded.
+             */
+            bool setTlsSessionCacheFile(const QString& newFilename);
+
+            /**
+             * Method you can use to determine the file used to persist TLS session tickets.
+             *
+             * \return Returns the TLS session cache file.  An empty string is returned if the cache is disabled.
+             */
+            const QString& tlsSessionCacheFile() const;
+
+            /**
+             * Method you can use to move this server onto a dedicated network thread owned by the server.  The
+             * network access manager is moved with the server, so neither the server nor the network access manager
+             * may have a parent.  Call this method before issuing any requests.
+             *
+             * REST API instances using this server must also live on the network thread.  You can either move them
+             * there using QObject::moveToThread or create them from a task passed to \ref submit.
+             *
+             * Configuration methods such as \ref setTimeDeltaRefreshInterval and \ref setTimeDeltaCacheFile are not
+             * thread safe and must be called from the thread the server lives on.  Once the network thread is
+             * running, call them from a task passed to \ref submit.
+             */
+            void startNetworkThread();
+
+            /**
+             * Method you can use to stop the network thread started by \ref startNetworkThread.  The server and
+             * network access manager are moved back to the calling thread.  This method must not be called from the
+             * network thread.
+             */
+            void stopNetworkThread();
+
+            /**
+             * Method you can use to obtain the network thread started by \ref startNetworkThread.
+             *
+             * \return Returns the network thread.  A null pointer is returned if no network thread is running.
+             */
+            QThread* networkThread() const;
+
+            /**
+             * Method you can use to run a task on the thread this server lives in.  This method can be called from
+             * any thread.  Tasks are placed on a lock-free queue and run in submission order.  Only the first task
+             * submitted while the queue is idle posts an event to wake the server's thread.
+             *
+             * \param[in] task The task to be run.
+             */
+            void submit(const Task& task);
+
+            /**
+             * Method you can use to obtain an executor that runs tasks on the thread of a given object.
+             *
+             * \param[in] context The object whose thread should run the tasks.  Tasks are discarded if the object is
+             *                    destroyed before they are run.
+             *
+             * \return Returns an executor that queues tasks to the object's thread.
+             */
+            static Executor queuedExecutor(QObject* context);
+
+        public slots:
+            /**
+             * Slot you can use to trigger a background update of the time delta.  REST API instances will continue to
+             * use the current time delta while the update is in progress.  The call is ignored if an update is
+             * already in progress.
+             */
+            void refreshTimeDelta();
+
+            /**
+             * Slot you can use to open a connection to the server ahead of the first request.  The connection is
+             * established in the background so that the first request does not pay for DNS resolution, the TCP
+             * handshake and, for HTTPS, the TLS handshake.  One connection is opened for each network access manager
+             * in the pool.  When HTTP/2 is enabled, HTTP/2 is offered during the TLS handshake so that the connection
+             * can be reused by later requests.
+             */
+            void prewarm();
+
+        signals:
+            /**
+             * Signal you can bind to in order to receive notification that the server time delta has changed.
+             */
+            void timeDeltaChanged();
+
+            /**
+             * Signal you can bind to in order to receive notification that the server time delta update failed.
+             */
+            void timeDeltaUpdateFailed();
+
+        private slots:
+            /**
+             * Slot that is triggered when a reply or error occurs for an outbound message.
+             */
+            void responseReceived();
+
+            /**
+             * Slot that resumes the next batch of REST API instances after a time delta update.
+             */
+            void resumeWaitingRestApis();
+
+            #ifndef QT_NO_SSL
+
+                /**
+                 * Slot that is triggered when a new encrypted connection is established.
+                 *
+                 * \param[in] reply The reply that triggered the connection.
+                 */
+                void connectionEncrypted(QNetworkReply* reply);
+
+            #endif
+
+        private:
+            friend class RestApi;
+
+            /**
+             * Method you can call to trigger the time delta to be updated.
+             *
+             * \param[in] restApi The REST API making this request.
+             */
+            void updateTimeDelta(RestApi* restApi);
+
+            /**
+             * Method you can call to check if a timestamp update is in progress.  If an update is in progress then
+             * the provided REST API instance will be included on a list to receive a callback.
+             *
+             * \param[in] restApi The REST API making this request.
+             *
+             * \return Returns true if the timestamp is believed to be accurate.  Returns false if the timestamp is not
+             *         accurate.
+             */
+            bool checkTimestamp(RestApi* restApi);
+
+            /**
+             * Method that runs all tasks submitted through \ref submit.
+             */
+            void drainSubmissions();
+
+            /**
+             * Method that removes a REST API instance from all pending notification lists.  This method is called
+             * when a REST API instance is destroyed.
+             *
+             * \param[in] restApi The REST API being removed.
+             */
+            void removeRestApi(RestApi* restApi);
+
+            /**
+             * Method that updates the passive time delta estimate from a response's Date header.
+             *
+             * \param[in] reply   The received network reply.
+             *
+             * \param[in] latency The measured latency for the reply, in mSec.
+             */
+            void processDateHeader(const QNetworkReply* reply, long long latency);
+
+            /**
+             * Method that updates the latency and error rate statistics.
+             *
+             * \param[in] reply   The received network reply.
+             *
+             * \param[in] latency The time between sending the request and receiving the response, in mSec.
+             */
+            void recordResponse(const QNetworkReply* reply, long long latency);
+
+            /**
+             * Method that records an authentication failure.
+             *
+             * \param[in] signatureMargin The distance between the expected arrival time of the request and the
+             *                            nearest signing window boundary, in mSec.
+             */
+            void recordAuthenticationFailure(long long signatureMargin);
+
+            /**
+             * Method that records that a request was signed.
+             */
+            inline void recordSignature() {
+                signedRequestCount.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            /**
+             * Value indicating the number of allowed retries.
+             */
+            static constexpr unsigned numberRetries = 2;
+
+            /**
+             * The number of Date header samples used to estimate the time delta when passive tracking is enabled.
+             */
+            static constexpr unsigned numberPassiveSamples = 9;
+
+            /**
+             * The minimum number of Date header samples required before the passive estimate is used.
+             */
+            static constexpr unsigned minimumPassiveSamples = 3;
+
+            /**
+             * The minimum difference, in mSec, between the passive estimate and the current time delta before the
+             * time delta is updated.  Date headers have one second resolution so small differences are ignored.
+             */
+            static constexpr long long passiveTimeDeltaTolerance = 2000;
+
+            /**
+             * The weight applied to new samples when updating the smoothed latency.
+             */
+            static constexpr double latencyWeight = 0.2;
+
+            /**
+             * The weight applied to new samples when updating the smoothed error rate.
+             */
+            static constexpr double errorRateWeight = 0.1;
+
+            /**
+             * The number of recent latency samples retained to calculate latency percentiles.
+             */
+            static constexpr unsigned numberLatencySamples = 256;
+
+            /**
+             * Method that issues a new time-delta request.
+             */
+            void issueTimeDeltaRequest();
+
+            /**
+             * Structure holding a request waiting to be issued.
+             */
+            struct ScheduledRequest {
+                /**
+                 * The request's ticket.
+                 */
+                unsigned long long ticket;
+
+                /**
+                 * The function used to issue the request.
+                 */
+                Issuer issuer;
+
+                /**
+                 * The request endpoint.
+                 */
+                QString endpoint;
+
+                /**
+                 * The rate limiting key of the secret used to sign the request.
+                 */
+                QByteArray secretKey;
+            };
+
+            /**
+             * Structure holding the state of a token bucket.
+             */
+            struct TokenBucket {
+                /**
+                 * The refill rate, in tokens per mSec.
+                 */
+                double rate;
+
+                /**
+                 * The maximum number of tokens.
+                 */
+                double capacity;
+
+                /**
+                 * The number of tokens at the last update.
+                 */
+                double tokens;
+
+                /**
+                 * The rate limit clock value at the last update, in mSec.
+                 */
+                long long lastUpdate;
+            };
+
+            /**
+             * Structure holding the requests from one source waiting to be issued.
+             */
+            struct ScheduledSource {
+                /**
+                 * Value identifying the source.
+                 */
+                const void* source;
+
+                /**
+                 * The source's waiting requests, in the order they were scheduled.
+                 */
+                QList<ScheduledRequest> requests;
+            };
+
+            /**
+             * Method that issues a scheduled request and tracks the resulting reply.
+             *
+             * \param[in] issuer The function used to issue the request.
+             */
+            void issueScheduled(const Issuer& issuer);
+
+            /**
+             * Method that releases the in-flight slot held by a reply.
+             *
+             * \param[in] reply The reply.
+             */
+            void releaseInFlight(QObject* reply);
+
+            /**
+             * Method that issues waiting requests while in-flight slots are available.
+             */
+            void dispatchScheduled();
+
+            /**
+             * Method that calculates the number of tokens in a bucket.
+             *
+             * \param[in] bucket The token bucket.
+             *
+             * \param[in] now    The current rate limit clock value, in mSec.
+             *
+             * \return Returns the number of available tokens.
+             */
+            static double availableTokens(const TokenBucket& bucket, long long now);
+
+            /**
+             * Method that determines how long a request must wait before the rate limits allow it to be sent.
+             *
+             * \param[in] endpoint  The request endpoint.
+             *
+             * \param[in] secretKey The rate limiting key of the secret used to sign the request.
+             *
+             * \return Returns the required wait, in mSec.  A value of 0 indicates that the request can be sent now.
+             */
+            long long rateLimitDelay(const QString& endpoint, const QByteArray& secretKey) const;
+
+            /**
+             * Method that takes a token from each bucket that applies to a request.
+             *
+             * \param[in] endpoint  The request endpoint.
+             *
+             * \param[in] secretKey The rate limiting key of the secret used to sign the request.
+             */
+            void consumeTokens(const QString& endpoint, const QByteArray& secretKey);
+
+            /**
+             * Method that arranges for waiting requests to be reconsidered once tokens become available.
+             *
+             * \param[in] delay The time until tokens become available, in mSec.
+             */
+            void startRateLimitTimer(long long delay);
+
+            /**
+             * Method that determines if another scheduled request can be issued.
+             *
+             * \return Returns true if an in-flight slot is available.  Returns false if all slots are in use.
+             */
+            bool inFlightSlotAvailable() const;
+
+            /**
+             * Method that adjusts the adaptive concurrency limit based on a response.
+             *
+             * \param[in] overloaded True if the response indicates that the host is overloaded or failing.
+             *
+             * \param[in] latency    The time between sending the request and receiving the response, in mSec.
+             */
+            void updateConcurrencyLimit(bool overloaded, long long latency);
+
+            /**
+             * The adaptive concurrency limit used when adaptive concurrency control is first enabled, before bounds
+             * are applied.
+             */
+            static constexpr double initialConcurrencyLimit = 8.0;
+
+            /**
+             * The factor applied to the adaptive concurrency limit when the host is overloaded.
+             */
+            static constexpr double concurrencyDecreaseFactor = 0.8;
+
+            /**
+             * The ratio between a response's latency and the baseline latency above which the host is considered
+             * congested.
+             */
+            static constexpr double congestionLatencyRatio = 2.0;
+
+            /**
+             * Latency, in mSec, always allowed above the baseline latency before the host is considered congested.
+             * This prevents jitter on very fast hosts from shrinking the limit.
+             */
+            static constexpr long long congestionLatencySlack = 5;
+
+            /**
+             * The weight used to let the baseline latency drift up toward recent latencies so that the baseline can
+             * follow a host whose unloaded latency has increased.
+             */
+            static constexpr double baselineLatencyDriftWeight = 0.01;
+
+            /**
+             * Method that applies this server's settings to a network access manager.
+             *
+             * \param[in] manager The network access manager to configure.
+             */
+            void configureNetworkAccessManager(QNetworkAccessManager* manager);
+
+            /**
+             * Method that selects the network access manager used to send a request.
+             *
+             * \param[in] request The request to be sent.
+             *
+             * \return Returns the network access manager to use.
+             */
+            QNetworkAccessManager* selectNetworkAccessManager(const QNetworkRequest& request);
+
+            /**
+             * Method that is triggered when a reply issued through an additional pool manager finishes.  Managers
+             * removed from the pool are released once their last reply finishes.
+             *
+             * \param[in] manager The manager that issued the reply.
+             */
+            void poolReplyFinished(QNetworkAccessManager* manager);
+
+            /**
+             * Method that determines if requests other than time delta requests are sent through the network access
+             * managers, and therefore honor the HTTP/2 settings.
+             *
+             * \return Returns true if the HTTP/2 settings apply to all requests.  Returns false if the pipelined
+             *         transport or a custom transport is in use.
+             */
+            bool http2Applies() const;
+
+            /**
+             * Method that applies the HTTP/2 settings to a request.
+             *
+             * \param[in,out] request The request to be updated.
+             */
+            void configureHttp2(QNetworkRequest& request) const;
+
+            /**
+             * Method that rebuilds the HTTP/2 configuration from the current settings.
+             *
+             * \return Returns true if Qt accepted every setting.  Returns false if any setting was rejected.
+             */
+            bool updateHttp2Configuration();
+
+            /**
+             * Method that issues a post request using a specific network access manager.
+             *
+             * \param[in] manager The network access manager to use.
+             *
+             * \param[in] request The network request to be sent.
+             *
+             * \param[in] payload The payload to be sent.
+             *
+             * \return Returns a newly created network reply instance.
+             */
+            QNetworkReply* post(
+                QNetworkAccessManager* manager,
+                const QNetworkRequest& request,
+                const QByteArray&      payload
+            );
+
+            /**
+             * Method that parses the received JSON response.
+             *
+             * \param[in] document The received JSON document.
+             *
+             * \return Returns true on success.  Returns false on error.
+             */
+            bool parseResponse(const QJsonDocument& document);
+
+            /**
+             * Method that schedules the next background time delta update, if enabled.
+             */
+            void scheduleTimeDeltaRefresh();
+
+            /**
+             * Method that loads the time delta snapshot.
+             *
+             * \param[in] maximumAge The maximum age of a usable snapshot, in seconds.
+             *
+             * \return Returns true on success.  Returns false if no usable snapshot was found.
+             */
+            bool loadTimeDeltaCache(unsigned long maximumAge);
+
+            /**
+             * Method that saves the time delta snapshot.
+             */
+            void saveTimeDeltaCache();
+
+            /**
+             * The network access manager to be used.
+             */
+            QNetworkAccessManager* currentNetworkAccessManager;
+
+            /**
+             * The current server URL and scheme.
+             */
+            QUrl currentSchemeAndHost;
+
+            /**
+             * The current time delta slug.
+             */
+            QString currentTimeDeltaSlug;
+
+            /**
+             * The current default secret to use for web requests.
+             */
+            QByteArray currentDefaultSecret;
+
+            /**
+             * Value that changes each time a default secret is set.  REST API instances use this value to detect
+             * that cached signing keys are stale.  Values are unique across all servers.
+             */
+            unsigned long long defaultSecretGeneration;
+
+            /**
+             * The current user agent string.
+             */
+            QString currentUserAgent;
+
+            /**
+             * The last measured time delta, in mSec.  The value is atomic so that it can be read by any thread
+             * without holding the request mutex.
+             */
+            std::atomic<long long> currentTimeDelta;
+
+            /**
+             * Estimator used to filter the results of explicit time delta requests.
+             */
+            TimeDeltaEstimator timeDeltaEstimator;
+
+            /**
+             * The wall clock time, in mSec since the epoch, when the pending time delta request was sent.
+             */
+            long long timeDeltaRequestTimestamp;
+
+            /**
+             * Monotonic timer used to measure the round trip time of the pending time delta request.
+             */
+            QElapsedTimer timeDeltaRequestTimer;
+
+            /**
+             * The expected one-way transit time to the server, in mSec.
+             */
+            std::atomic<long long> currentTransitTime;
+
+            /**
+             * The number of signed requests.
+             */
+            std::atomic<unsigned long long> signedRequestCount;
+
+            /**
+             * The number of authentication failures.
+             */
+            std::atomic<unsigned long long> authenticationFailureCount;
+
+            /**
+             * The number of authentication failures attributed to signing window boundaries.
+             */
+            std::atomic<unsigned long long> boundaryMissCount;
+
+            /**
+             * Mutex used to protect the latency and error rate statistics.
+             */
+            mutable QMutex statisticsMutex;
+
+            /**
+             * The smoothed latency, in mSec.
+             */
+            double currentAverageLatency;
+
+            /**
+             * The smoothed error rate.
+             */
+            double currentErrorRate;
+
+            /**
+             * The number of responses used to calculate the statistics.
+             */
+            unsigned long long currentNumberResponses;
+
+            /**
+             * Circular buffer of recent latency samples, in mSec.
+             */
+            QList<long long> latencySamples;
+
+            /**
+             * Index of the next latency sample to be replaced.
+             */
+            unsigned nextLatencySampleIndex;
+
+            /**
+             * Mutex used to prevent bad concurrent access to the time delta request state.
+             */
+            QMutex requestMutex;
 
             /**
              * The network reply for the currently outstanding time delta network request.
              */
             QNetworkReply* pendingReply;
 
+            /**
+             * Flag indicating that the outstanding time delta request is a background request.  REST API instances
+             * are not held waiting on background requests.
+             */
+            bool backgroundRequest;
+
+            /**
+             * Flag indicating that REST API instances must wait for a time delta update.  The flag is only modified
+             * while holding the request mutex but may be read without it, allowing the common case to avoid the lock.
+             */
+            std::atomic<bool> timestampUpdatePending;
+
             /**
              * Value used to support retries to our server.
              */
@@ -362,6 +1708,247 @@ namespace RestApiOutV1 {
              * A list of RestApi instances waiting for a timestamp update.
              */
             QList<RestApi*> waitingRestApis;
+
+            /**
+             * A list of RestApi instances waiting to be resumed after a successful timestamp update.
+             */
+            QList<RestApi*> resumingRestApis;
+
+            /**
+             * A list of RestApi instances waiting to be told that a timestamp update failed.
+             */
+            QList<RestApi*> failingRestApis;
+
+            /**
+             * The maximum number of RestApi instances to resume at once.
+             */
+            unsigned currentResumeBatchSize;
+
+            /**
+             * The delay between batches of resumed RestApi instances, in mSec.
+             */
+            unsigned long currentResumeInterval;
+
+            /**
+             * Timer used to pace resumption of RestApi instances.
+             */
+            QTimer resumeTimer;
+
+            /**
+             * The nominal interval between background time delta updates, in mSec.
+             */
+            unsigned long currentRefreshInterval;
+
+            /**
+             * The maximum jitter to apply to background time delta updates, in mSec.
+             */
+            unsigned long currentRefreshJitter;
+
+            /**
+             * Timer used to trigger background time delta updates.
+             */
+            QTimer refreshTimer;
+
+            /**
+             * The pool of network access managers used to send requests.  The first entry is always the network
+             * access manager provided to the constructor.
+             */
+            QList<QNetworkAccessManager*> networkAccessManagerPool;
+
+            /**
+             * Hash table holding the number of outstanding replies for each additional manager this server created
+             * for the pool, including managers removed from the pool that are still draining.
+             */
+            QHash<QNetworkAccessManager*, unsigned long> poolReplyCounts;
+
+            /**
+             * The current sharding policy.
+             */
+            ShardingPolicy currentShardingPolicy;
+
+            /**
+             * Counter used to assign requests when using round-robin sharding.
+             */
+            std::atomic<unsigned> nextNetworkAccessManagerIndex;
+
+            /**
+             * Flag indicating if HTTP/2 is enabled.
+             */
+            bool currentHttp2Enabled;
+
+            /**
+             * The HTTP/2 stream receive window size.  A value of 0 indicates the Qt default.
+             */
+            unsigned currentHttp2StreamReceiveWindowSize;
+
+            /**
+             * The HTTP/2 session receive window size.  A value of 0 indicates the Qt default.
+             */
+            unsigned currentHttp2SessionReceiveWindowSize;
+
+            /**
+             * The HTTP/2 maximum frame size.  A value of 0 indicates the Qt default.
+             */
+            unsigned currentHttp2MaximumFrameSize;
+
+            /**
+             * The HTTP/2 configuration applied to requests.
+             */
+            QHttp2Configuration currentHttp2Configuration;
+
+            /**
+             * The pipelined HTTP client.  A null pointer if the pipelined transport is disabled.
+             */
+            PipelinedHttpClient* currentPipelinedHttpClient;
+
+            /**
+             * The custom transport.  A null pointer if no custom transport is set.
+             */
+            Transport* currentTransport;
+
+            /**
+             * The maximum number of outstanding scheduled requests.  A value of 0 indicates no limit.
+             */
+            unsigned long currentMaximumInFlightRequests;
+
+            /**
+             * Replies for outstanding scheduled requests.
+             */
+            QSet<QObject*> inFlightReplies;
+
+            /**
+             * Sources with waiting requests, by priority class.  Sources are served in turn within each class.
+             */
+            QMap<Priority, QList<ScheduledSource>> scheduledSources;
+
+            /**
+             * The priority class of each waiting request, by ticket.
+             */
+            QHash<unsigned long long, Priority> scheduledTickets;
+
+            /**
+             * The next ticket to be handed out.
+             */
+            unsigned long long nextScheduleTicket;
+
+            /**
+             * Flag indicating that waiting requests are being issued.
+             */
+            bool dispatchingScheduled;
+
+            /**
+             * The maximum number of waiting requests.  A value of 0 indicates no limit.
+             */
+            unsigned long currentMaximumScheduledRequests;
+
+            /**
+             * Flag indicating if adaptive concurrency control is enabled.
+             */
+            bool currentAdaptiveConcurrencyEnabled;
+
+            /**
+             * The current adaptive concurrency limit.  Fractional values allow the limit to grow gradually.
+             */
+            double currentConcurrencyLimit;
+
+            /**
+             * The lowest allowed adaptive concurrency limit.
+             */
+            unsigned long currentMinimumConcurrencyLimit;
+
+            /**
+             * The highest allowed adaptive concurrency limit.
+             */
+            unsigned long currentMaximumConcurrencyLimit;
+
+            /**
+             * The baseline latency used to detect congestion, in mSec.  A negative value indicates no baseline.
+             */
+            double baselineLatency;
+
+            /**
+             * Timer measuring the time since the adaptive concurrency limit was last reduced.
+             */
+            QElapsedTimer concurrencyDecreaseTimer;
+
+            /**
+             * Token buckets by endpoint.
+             */
+            QHash<QString, TokenBucket> endpointBuckets;
+
+            /**
+             * Token buckets by secret rate limiting key.
+             */
+            QHash<QByteArray, TokenBucket> secretBuckets;
+
+            /**
+             * The rate limiting key of the default secret.
+             */
+            QByteArray defaultSecretRateKey;
+
+            /**
+             * Clock used to refill the token buckets.
+             */
+            QElapsedTimer rateLimitClock;
+
+            /**
+             * Timer used to issue requests held by the rate limits once tokens become available.
+             */
+            QTimer rateLimitTimer;
+
+            /**
+             * Queue of tasks submitted from other threads.
+             */
+            MpscQueue<Task> submissionQueue;
+
+            /**
+             * Flag indicating that the server's thread has been asked to run the submitted tasks.
+             */
+            std::atomic<bool> drainScheduled;
+
+            /**
+             * The network thread owned by this server.
+             */
+            QThread* currentNetworkThread;
+
+            /**
+             * Flag indicating if passive time delta tracking is enabled.
+             */
+            std::atomic<bool> currentPassiveTrackingEnabled;
+
+            /**
+             * Circular buffer of recent time delta samples taken from response Date headers.
+             */
+            QList<long long> passiveSamples;
+
+            /**
+             * Index of the next passive sample to be replaced.
+             */
+            unsigned nextPassiveSampleIndex;
+
+            /**
+             * The file used to persist the time delta.
+             */
+            QString currentTimeDeltaCacheFile;
+
+            /**
+             * The file used to persist TLS session tickets.
+             */
+            QString currentTlsSessionCacheFile;
+
+            #ifndef QT_NO_SSL
+
+                /**
+                 * The SSL configuration used when TLS session caching is enabled.
+                 */
+                QSslConfiguration currentSslConfiguration;
+
+                /**
+                 * The last persisted TLS session ticket.
+                 */
+                QByteArray currentSessionTicket;
+
+            #endif
     };
 }
 
@@ -0,0 +1,220 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref RestApiOutV1::ServerGroup class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project inerest_api_out_v1 */
+
+#ifndef REST_API_OUT_V1_SERVER_GROUP_H
+#define REST_API_OUT_V1_SERVER_GROUP_H
+
+#include <QObject>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QElapsedTimer>
+
+#include "rest_api_out_v1_common.h"
+
+namespace RestApiOutV1 {
+    class Server;
+
+    /**
+     * Class that manages a group of \ref Server instances fronting replicas of the same API.  Each server tracks its
+     * own time delta and time delta update state.  The group routes requests to servers based on their smoothed
+     * latency and error rate, ejecting servers with a high error rate and re-admitting them after a back-off period.
+     *
+     * To route a REST API's requests through a group, call \ref Server::RestApi::setServerGroup.  Servers added to a
+     * group should share a single network access manager so that connections are pooled.
+     */
+    class REST_API_OUT_V1_PUBLIC_API ServerGroup:public QObject {
+        Q_OBJECT
+
+        public:
+            /**
+             * The default error rate above which a server is ejected.
+             */
+            static const double defaultEjectionErrorRate;
+
+            /**
+             * The default duration, in mSec, that a server remains ejected.
+             */
+            static const unsigned long defaultEjectionDuration;
+
+            /**
+             * The minimum number of responses a server must have reported before it can be ejected.
+             */
+            static const unsigned long long minimumResponsesForEjection;
+
+            /**
+             * Constructor
+             *
+             * \param[in] parent Pointer to the parent object.
+             */
+            ServerGroup(QObject* parent = Q_NULLPTR);
+
+            ~ServerGroup() override;
+
+            /**
+             * Method you can use to add a server to the group.  The group does not take ownership of the server.
+             *
+             * \param[in] server The server to be added.
+             */
+            void addServer(Server* server);
+
+            /**
+             * Method you can use to remove a server from the group.
+             *
+             * \param[in] server The server to be removed.
+             */
+            void removeServer(Server* server);
+
+            /**
+             * Method you can use to obtain the servers in the group.
+             *
+             * \return Returns a list of servers in the group.
+             */
+            QList<Server*> servers() const;
+
+            /**
+             * Method you can use to set the error rate above which a server is ejected.
+             *
+             * \param[in] newErrorRate The new ejection error rate, between 0 and 1.
+             */
+            void setEjectionErrorRate(double newErrorRate);
+
+            /**
+             * Method you can use to obtain the error rate above which a server is ejected.
+             *
+             * \return Returns the ejection error rate.
+             */
+            double ejectionErrorRate() const;
+
+            /**
+             * Method you can use to set the time a server remains ejected before it is re-admitted.
+             *
+             * \param[in] newDuration The new ejection duration, in mSec.
+             */
+            void setEjectionDuration(unsigned long newDuration);
+
+            /**
+             * Method you can use to obtain the time a server remains ejected before it is re-admitted.
+             *
+             * \return Returns the ejection duration, in mSec.
+             */
+            unsigned long ejectionDuration() const;
+
+            /**
+             * Method you can use to determine if a server is currently ejected.
+             *
+             * \param[in] server The server to check.
+             *
+             * \return Returns true if the server is ejected.  Returns false if the server is accepting requests.
+             */
+            bool isEjected(Server* server) const;
+
+            /**
+             * Method that selects the server that should receive the next request.  Two healthy servers are chosen
+             * at random and the one with the lower cost, based on smoothed latency and error rate, is selected.
+             * Choosing between two random candidates keeps latency information for every server fresh while still
+             * strongly favoring the fastest servers.
+             *
+             * \return Returns the selected server.  A null pointer is returned if the group is empty.
+             */
+            Server* selectServer();
+
+        signals:
+            /**
+             * Signal that is emitted when a server is ejected from the group.
+             *
+             * \param[out] server The ejected server.
+             */
+            void serverEjected(Server* server);
+
+            /**
+             * Signal that is emitted when an ejected server is re-admitted to the group.
+             *
+             * \param[out] server The re-admitted server.
+             */
+            void serverReadmitted(Server* server);
+
+        private:
+            /**
+             * Method that calculates the routing cost for a server.
+             *
+             * \param[in] server The server to calculate the cost for.
+             *
+             * \return Returns the routing cost.  Lower values are preferred.
+             */
+            static double cost(const Server* server);
+
+            /**
+             * Method that calculates the median latency across the servers that are not ejected.  The method is
+             * called with the group mutex held.
+             *
+             * \return Returns the median latency, in mSec.  A negative value is returned if no server in the group
+             *         has latency data.
+             */
+            double medianLatency() const;
+
+            /**
+             * Method that updates the ejection state of every server.  The method is called with the group mutex
+             * held.
+             *
+             * \param[out] ejected    List populated with newly ejected servers.
+             *
+             * \param[out] readmitted List populated with newly re-admitted servers.
+             */
+            void updateEjections(QList<Server*>& ejected, QList<Server*>& readmitted);
+
+            /**
+             * Mutex used to protect the group.
+             */
+            mutable QMutex groupMutex;
+
+            /**
+             * The servers in the group.
+             */
+            QList<Server*> currentServers;
+
+            /**
+             * Hash table holding the time, relative to the group timer, when each ejected server will be
+             * re-admitted.
+             */
+            QHash<Server*, long long> ejectedUntil;
+
+            /**
+             * Timer used to track ejection periods.
+             */
+            QElapsedTimer groupTimer;
+
+            /**
+             * The current ejection error rate.
+             */
+            double currentEjectionErrorRate;
+
+            /**
+             * The current ejection duration, in mSec.
+             */
+            unsigned long currentEjectionDuration;
+    };
+}
+
+#endif
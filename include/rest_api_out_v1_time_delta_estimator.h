@@ -0,0 +1,204 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref RestApiOutV1::TimeDeltaEstimator class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project inerest_api_out_v1 */
+
+#ifndef REST_API_OUT_V1_TIME_DELTA_ESTIMATOR_H
+#define REST_API_OUT_V1_TIME_DELTA_ESTIMATOR_H
+
+#include <QList>
+#include <QElapsedTimer>
+
+#include "rest_api_out_v1_common.h"
+
+namespace RestApiOutV1 {
+    /**
+     * Class that estimates the time delta between us and a remote server from a series of round trip measurements.
+     * The class uses the same approach as the NTP clock filter.  Each sample is compensated for half of the round
+     * trip time and the sample with the smallest error bound is selected from the most recent samples.  As with NTP,
+     * a sample's error bound grows with its age to allow for drift of the local clock, so an old sample with a short
+     * round trip time eventually loses out to newer samples.
+     *
+     * All values are in mSec.
+     */
+    class REST_API_OUT_V1_PUBLIC_API TimeDeltaEstimator {
+        public:
+            /**
+             * The default number of samples to retain.
+             */
+            static constexpr unsigned defaultNumberSamples = 8;
+
+            /**
+             * The resolution of the remote server's clock, in mSec.  This value contributes to the reported
+             * uncertainty.
+             */
+            static constexpr long long serverResolution = 1000;
+
+            /**
+             * Constructor
+             *
+             * \param[in] numberSamples The number of recent samples to retain.
+             */
+            TimeDeltaEstimator(unsigned numberSamples = defaultNumberSamples);
+
+            ~TimeDeltaEstimator();
+
+            /**
+             * Method you can use to add a new sample.
+             *
+             * \param[in] timeDelta     The measured time delta, compensated for transit time to the server.
+             *
+             * \param[in] roundTripTime The round trip time for the measurement.
+             */
+            void addSample(long long timeDelta, long long roundTripTime);
+
+            /**
+             * Method you can use to discard all samples.
+             */
+            void clear();
+
+            /**
+             * Method you can use to determine if the estimator holds at least one sample.
+             *
+             * \return Returns true if the estimator holds at least one sample.  Returns false if the estimator is
+             *         empty.
+             */
+            bool isValid() const;
+
+            /**
+             * Method you can use to determine if the estimator holds no samples.
+             *
+             * \return Returns true if the estimator is empty.  Returns false if the estimator holds samples.
+             */
+            bool isInvalid() const;
+
+            /**
+             * Method you can use to obtain the current filtered time delta.
+             *
+             * \return Returns the filtered time delta.  A value of 0 is returned if there are no samples.
+             */
+            long long timeDelta() const;
+
+            /**
+             * Method you can use to obtain the uncertainty of the current filtered time delta.  The value is
+             * calculated from the round trip time of the selected sample, the resolution of the server's clock, the
+             * dispersion of the retained samples, and an allowance for clock drift since the selected sample was
+             * taken.
+             *
+             * \return Returns the uncertainty of the filtered time delta.  A negative value is returned if there are
+             *         no samples.
+             */
+            long long uncertainty() const;
+
+            /**
+             * Method you can use to obtain the round trip time of the selected sample.
+             *
+             * \return Returns the round trip time of the selected sample.  A negative value is returned if there are
+             *         no samples.
+             */
+            long long roundTripTime() const;
+
+            /**
+             * Method you can use to determine the number of samples currently retained.
+             *
+             * \return Returns the number of retained samples.
+             */
+            unsigned numberSamples() const;
+
+        private:
+            /**
+             * Structure holding a single sample.
+             */
+            struct Sample {
+                /**
+                 * The compensated time delta.
+                 */
+                long long timeDelta;
+
+                /**
+                 * The measured round trip time.
+                 */
+                long long roundTripTime;
+
+                /**
+                 * The time the sample was taken, relative to the estimator's clock.
+                 */
+                long long sampleTime;
+            };
+
+            /**
+             * Method that recalculates the filtered estimate.
+             */
+            void update();
+
+            /**
+             * Method that calculates the allowance for clock drift since a sample was taken.
+             *
+             * \param[in] sampleTime The time the sample was taken, relative to the estimator's clock.
+             *
+             * \return Returns the drift allowance, in mSec.
+             */
+            long long driftAllowance(long long sampleTime) const;
+
+            /**
+             * Monotonic clock used to determine the age of each sample.
+             */
+            QElapsedTimer clock;
+
+            /**
+             * The maximum number of samples to retain.
+             */
+            unsigned maximumNumberSamples;
+
+            /**
+             * Circular buffer of retained samples.
+             */
+            QList<Sample> samples;
+
+            /**
+             * Index of the next sample to be replaced.
+             */
+            unsigned nextSampleIndex;
+
+            /**
+             * The current filtered time delta.
+             */
+            long long currentTimeDelta;
+
+            /**
+             * The current uncertainty, excluding the drift allowance for the selected sample.
+             */
+            long long currentUncertainty;
+
+            /**
+             * The time the selected sample was taken, relative to the estimator's clock.
+             */
+            long long currentSampleTime;
+
+            /**
+             * The round trip time of the selected sample.
+             */
+            long long currentRoundTripTime;
+    };
+}
+
+#endif
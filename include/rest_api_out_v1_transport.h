@@ -0,0 +1,69 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This header defines the \ref RestApiOutV1::Transport class.
+***********************************************************************************************************************/
+
+/* .. sphinx-project inerest_api_out_v1 */
+
+#ifndef REST_API_OUT_V1_TRANSPORT_H
+#define REST_API_OUT_V1_TRANSPORT_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+
+#include "rest_api_out_v1_common.h"
+
+namespace RestApiOutV1 {
+    /**
+     * Pure virtual base class for transports used by \ref RestApiOutV1::Server to deliver requests.  A transport
+     * replaces the network access manager for requests issued through the server.
+     *
+     * Replies must report their result through the standard QNetworkReply interface and must not emit the finished
+     * signal before \ref post returns.
+     */
+    class REST_API_OUT_V1_PUBLIC_API Transport:public QObject {
+        Q_OBJECT
+
+        public:
+            /**
+             * Constructor
+             *
+             * \param[in] parent Pointer to the parent object.
+             */
+            Transport(QObject* parent = nullptr);
+
+            ~Transport() override;
+
+            /**
+             * Method you can use to issue a post request.
+             *
+             * \param[in] request The network request to be sent.
+             *
+             * \param[in] payload The payload to be sent.
+             *
+             * \return Returns a newly created network reply instance.
+             */
+            virtual QNetworkReply* post(const QNetworkRequest& request, const QByteArray& payload) = 0;
+    };
+}
+
+#endif
@@ -37,6 +37,18 @@ HEADERS = include/rest_api_out_v1_common.h \
           include/rest_api_out_v1_inesonic_rest_handler_base.h \
           include/rest_api_out_v1_inesonic_rest_handler.h \
           include/rest_api_out_v1_inesonic_binary_rest_handler.h \
+          include/rest_api_out_v1_time_delta_estimator.h \
+          include/rest_api_out_v1_server_group.h \
+          include/rest_api_out_v1_mpsc_queue.h \
+          include/rest_api_out_v1_pipelined_network_reply.h \
+          include/rest_api_out_v1_pipelined_http_client.h \
+          include/rest_api_out_v1_transport.h \
+          include/rest_api_out_v1_local_socket_transport.h \
+          include/rest_api_out_v1_loopback_transport.h \
+          include/rest_api_out_v1_hmac_sha256.h \
+          include/rest_api_out_v1_base64.h \
+          include/rest_api_out_v1_inesonic_loopback_receiver.h \
+          include/rest_api_out_v1_inesonic_cbor_rest_handler.h \
 
 ########################################################################################################################
 # Source files
@@ -46,6 +58,17 @@ SOURCES = source/rest_api_out_v1_server.cpp \
           source/rest_api_out_v1_inesonic_rest_handler_base.cpp \
           source/rest_api_out_v1_inesonic_rest_handler.cpp \
           source/rest_api_out_v1_inesonic_binary_rest_handler.cpp \
+          source/rest_api_out_v1_time_delta_estimator.cpp \
+          source/rest_api_out_v1_server_group.cpp \
+          source/rest_api_out_v1_pipelined_network_reply.cpp \
+          source/rest_api_out_v1_pipelined_http_client.cpp \
+          source/rest_api_out_v1_transport.cpp \
+          source/rest_api_out_v1_local_socket_transport.cpp \
+          source/rest_api_out_v1_loopback_transport.cpp \
+          source/rest_api_out_v1_hmac_sha256.cpp \
+          source/rest_api_out_v1_base64.cpp \
+          source/rest_api_out_v1_inesonic_loopback_receiver.cpp \
+          source/rest_api_out_v1_inesonic_cbor_rest_handler.cpp \
 
 ########################################################################################################################
 # Libraries
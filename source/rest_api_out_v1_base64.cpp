@@ -0,0 +1,550 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref RestApiOutV1::Base64 class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QByteArray>
+
+#include <cstdint>
+#include <cstring>
+
+#if (defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)))
+    #define REST_API_OUT_V1_BASE64_X86
+    #include <immintrin.h>
+#endif
+
+#include "rest_api_out_v1_base64.h"
+
+namespace RestApiOutV1 {
+    static const char encodeTable[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+    /**
+     * Value used in the decode table to mark characters outside the alphabet.
+     */
+    static const std::uint8_t invalidCharacter = 0xFF;
+
+    /**
+     * Function that builds the table used to decode characters.
+     *
+     * \return Returns a pointer to the decode table.
+     */
+    static const std::uint8_t* decodeTable() {
+        struct Table {
+            Table() {
+                std::memset(values, invalidCharacter, sizeof(values));
+                for (unsigned i=0 ; i<64 ; ++i) {
+                    values[static_cast<std::uint8_t>(encodeTable[i])] = static_cast<std::uint8_t>(i);
+                }
+            }
+
+            std::uint8_t values[256];
+        };
+
+        static const Table table;
+        return table.values;
+    }
+
+
+    /**
+     * Function that encodes data using the portable implementation.
+     *
+     * \param[in] source      The data to be encoded.
+     *
+     * \param[in] length      The length of the data, in bytes.
+     *
+     * \param[in] destination Buffer to receive the encoded data.
+     *
+     * \return Returns a pointer just past the encoded data.
+     */
+    static char* encodeScalar(const std::uint8_t* source, unsigned long length, char* destination) {
+        const std::uint8_t* end = source + (length - length % 3);
+
+        while (source != end) {
+            std::uint32_t word = (
+                  (static_cast<std::uint32_t>(source[0]) << 16)
+                | (static_cast<std::uint32_t>(source[1]) <<  8)
+                | (static_cast<std::uint32_t>(source[2])      )
+            );
+
+            destination[0] = encodeTable[(word >> 18) & 0x3F];
+            destination[1] = encodeTable[(word >> 12) & 0x3F];
+            destination[2] = encodeTable[(word >>  6) & 0x3F];
+            destination[3] = encodeTable[(word      ) & 0x3F];
+
+            source      += 3;
+            destination += 4;
+        }
+
+        unsigned remaining = static_cast<unsigned>(length % 3);
+        if (remaining != 0) {
+            std::uint32_t word = static_cast<std::uint32_t>(source[0]) << 16;
+            if (remaining == 2) {
+                word |= static_cast<std::uint32_t>(source[1]) << 8;
+            }
+
+            destination[0] = encodeTable[(word >> 18) & 0x3F];
+            destination[1] = encodeTable[(word >> 12) & 0x3F];
+            destination[2] = remaining == 2 ? encodeTable[(word >> 6) & 0x3F] : '=';
+            destination[3] = '=';
+
+            destination += 4;
+        }
+
+        return destination;
+    }
+
+
+    /**
+     * Function that decodes data using the portable implementation.
+     *
+     * \param[in] source      The data to be decoded.
+     *
+     * \param[in] length      The length of the data, in bytes.
+     *
+     * \param[in] destination Buffer to receive the decoded data.
+     *
+     * \return Returns the length of the decoded data.  A negative value is returned if the data is invalid.
+     */
+    static long decodeScalar(const std::uint8_t* source, unsigned long length, std::uint8_t* destination) {
+        const std::uint8_t* table = decodeTable();
+
+        // Up to two padding characters are allowed and, when present, must complete a group of four characters.
+        unsigned padding = 0;
+        while (padding < 2 && length > 0 && source[length - 1] == '=') {
+            --length;
+            ++padding;
+        }
+
+        if (length % 4 == 1 || (padding != 0 && (length + padding) % 4 != 0)) {
+            return -1;
+        }
+
+        const std::uint8_t* end                = source + (length - length % 4);
+        std::uint8_t*       initialDestination = destination;
+
+        while (source != end) {
+            std::uint32_t a = table[source[0]];
+            std::uint32_t b = table[source[1]];
+            std::uint32_t c = table[source[2]];
+            std::uint32_t d = table[source[3]];
+
+            if (((a | b | c | d) & 0x80) != 0) {
+                return -1;
+            }
+
+            std::uint32_t word = (a << 18) | (b << 12) | (c << 6) | d;
+            destination[0] = static_cast<std::uint8_t>(word >> 16);
+            destination[1] = static_cast<std::uint8_t>(word >>  8);
+            destination[2] = static_cast<std::uint8_t>(word      );
+
+            source      += 4;
+            destination += 3;
+        }
+
+        unsigned remaining = static_cast<unsigned>(length % 4);
+        if (remaining != 0) {
+            std::uint32_t a = table[source[0]];
+            std::uint32_t b = table[source[1]];
+            std::uint32_t c = remaining == 3 ? table[source[2]] : 0;
+
+            if (((a | b | c) & 0x80) != 0) {
+                return -1;
+            }
+
+            std::uint32_t word = (a << 18) | (b << 12) | (c << 6);
+            destination[0] = static_cast<std::uint8_t>(word >> 16);
+            ++destination;
+
+            if (remaining == 3) {
+                destination[0] = static_cast<std::uint8_t>(word >> 8);
+                ++destination;
+            }
+        }
+
+        return static_cast<long>(destination - initialDestination);
+    }
+
+    #if (defined(REST_API_OUT_V1_BASE64_X86))
+
+        // The vector implementations follow the approach described by Wojciech Muła and Daniel Lemire in "Faster
+        // Base64 Encoding and Decoding Using AVX2 Instructions".  Each function handles whole blocks and returns the
+        // number of input bytes consumed so that the portable implementation can finish the tail.
+
+        /**
+         * Function that converts 6-bit values to base64 characters.
+         *
+         * \param[in] indices Vector of 6-bit values, one per byte.
+         *
+         * \return Returns the base64 characters.
+         */
+        __attribute__((target("ssse3"))) static inline __m128i lookupSsse3(__m128i indices) {
+            const __m128i shiftTable = _mm_setr_epi8(
+                'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A',      0,        0
+            );
+
+            __m128i result = _mm_subs_epu8(indices, _mm_set1_epi8(51));
+            __m128i less   = _mm_cmpgt_epi8(_mm_set1_epi8(26), indices);
+
+            result = _mm_or_si128(result, _mm_and_si128(less, _mm_set1_epi8(13)));
+            result = _mm_shuffle_epi8(shiftTable, result);
+
+            return _mm_add_epi8(result, indices);
+        }
+
+
+        /**
+         * Function that encodes whole blocks using SSSE3 instructions.
+         *
+         * \param[in] source      The data to be encoded.
+         *
+         * \param[in] length      The length of the data, in bytes.
+         *
+         * \param[in] destination Buffer to receive the encoded data.
+         *
+         * \return Returns the number of input bytes consumed.  The value is a multiple of 3.
+         */
+        __attribute__((target("ssse3"))) static unsigned long encodeSsse3(
+                const std::uint8_t* source,
+                unsigned long       length,
+                char*               destination
+            ) {
+            const __m128i shuffle = _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+
+            unsigned long consumed = 0;
+
+            // Each block reads 16 bytes but only encodes the first 12.
+            while (length - consumed >= 16) {
+                __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + consumed));
+                input = _mm_shuffle_epi8(input, shuffle);
+
+                __m128i t0 = _mm_and_si128(input, _mm_set1_epi32(0x0FC0FC00));
+                __m128i t1 = _mm_mulhi_epu16(t0, _mm_set1_epi32(0x04000040));
+                __m128i t2 = _mm_and_si128(input, _mm_set1_epi32(0x003F03F0));
+                __m128i t3 = _mm_mullo_epi16(t2, _mm_set1_epi32(0x01000010));
+
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), lookupSsse3(_mm_or_si128(t1, t3)));
+
+                consumed    += 12;
+                destination += 16;
+            }
+
+            return consumed;
+        }
+
+
+        /**
+         * Function that encodes whole blocks using AVX2 instructions.
+         *
+         * \param[in] source      The data to be encoded.
+         *
+         * \param[in] length      The length of the data, in bytes.
+         *
+         * \param[in] destination Buffer to receive the encoded data.
+         *
+         * \return Returns the number of input bytes consumed.  The value is a multiple of 3.
+         */
+        __attribute__((target("avx2"))) static unsigned long encodeAvx2(
+                const std::uint8_t* source,
+                unsigned long       length,
+                char*               destination
+            ) {
+            const __m256i shuffle = _mm256_set_epi8(
+                10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1,
+                10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1
+            );
+            const __m256i shiftTable = _mm256_setr_epi8(
+                'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A',      0,        0,
+                'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A',      0,        0
+            );
+
+            unsigned long consumed = 0;
+
+            // Each block encodes 24 bytes, 12 per lane, but the upper lane reads 16 bytes starting at byte 12.
+            while (length - consumed >= 28) {
+                const __m128i* lower = reinterpret_cast<const __m128i*>(source + consumed);
+                const __m128i* upper = reinterpret_cast<const __m128i*>(source + consumed + 12);
+
+                __m256i input = _mm256_inserti128_si256(
+                    _mm256_castsi128_si256(_mm_loadu_si128(lower)),
+                    _mm_loadu_si128(upper),
+                    1
+                );
+                input = _mm256_shuffle_epi8(input, shuffle);
+
+                __m256i t0      = _mm256_and_si256(input, _mm256_set1_epi32(0x0FC0FC00));
+                __m256i t1      = _mm256_mulhi_epu16(t0, _mm256_set1_epi32(0x04000040));
+                __m256i t2      = _mm256_and_si256(input, _mm256_set1_epi32(0x003F03F0));
+                __m256i t3      = _mm256_mullo_epi16(t2, _mm256_set1_epi32(0x01000010));
+                __m256i indices = _mm256_or_si256(t1, t3);
+
+                __m256i result = _mm256_subs_epu8(indices, _mm256_set1_epi8(51));
+                __m256i less   = _mm256_cmpgt_epi8(_mm256_set1_epi8(26), indices);
+
+                result = _mm256_or_si256(result, _mm256_and_si256(less, _mm256_set1_epi8(13)));
+                result = _mm256_shuffle_epi8(shiftTable, result);
+                result = _mm256_add_epi8(result, indices);
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), result);
+
+                consumed    += 24;
+                destination += 32;
+            }
+
+            return consumed;
+        }
+
+
+        /**
+         * Function that decodes whole blocks using SSSE3 instructions.  Decoding stops at the first block holding a
+         * character outside the alphabet, including padding.
+         *
+         * \param[in] source      The data to be decoded.
+         *
+         * \param[in] length      The length of the data, in bytes.
+         *
+         * \param[in] destination Buffer to receive the decoded data.
+         *
+         * \return Returns the number of input bytes consumed.  The value is a multiple of 4.
+         */
+        __attribute__((target("ssse3"))) static unsigned long decodeSsse3(
+                const std::uint8_t* source,
+                unsigned long       length,
+                std::uint8_t*       destination
+            ) {
+            const __m128i lowerNibbleTable = _mm_setr_epi8(
+                0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A
+            );
+            const __m128i upperNibbleTable = _mm_setr_epi8(
+                0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+            );
+            const __m128i rollTable = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0);
+            const __m128i pack      = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1);
+            const __m128i nibble    = _mm_set1_epi8(0x0F);
+
+            unsigned long consumed = 0;
+
+            // Each block writes 16 bytes but only 12 are valid.  We stop early enough that the extra bytes land in
+            // space that later output will fill.
+            while (length - consumed >= 24) {
+                __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + consumed));
+
+                __m128i upperNibbles = _mm_and_si128(_mm_srli_epi32(input, 4), nibble);
+                __m128i lowerNibbles = _mm_and_si128(input, nibble);
+                __m128i lower        = _mm_shuffle_epi8(lowerNibbleTable, lowerNibbles);
+                __m128i upper        = _mm_shuffle_epi8(upperNibbleTable, upperNibbles);
+
+                if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lower, upper), _mm_setzero_si128())) != 0xFFFF) {
+                    break;
+                }
+
+                __m128i isSlash = _mm_cmpeq_epi8(input, _mm_set1_epi8('/'));
+                __m128i roll    = _mm_shuffle_epi8(rollTable, _mm_add_epi8(isSlash, upperNibbles));
+                __m128i values  = _mm_add_epi8(input, roll);
+
+                __m128i merged = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+                __m128i output = _mm_madd_epi16(merged, _mm_set1_epi32(0x00011000));
+
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(destination), _mm_shuffle_epi8(output, pack));
+
+                consumed    += 16;
+                destination += 12;
+            }
+
+            return consumed;
+        }
+
+
+        /**
+         * Function that decodes whole blocks using AVX2 instructions.  Decoding stops at the first block holding a
+         * character outside the alphabet, including padding.
+         *
+         * \param[in] source      The data to be decoded.
+         *
+         * \param[in] length      The length of the data, in bytes.
+         *
+         * \param[in] destination Buffer to receive the decoded data.
+         *
+         * \return Returns the number of input bytes consumed.  The value is a multiple of 4.
+         */
+        __attribute__((target("avx2"))) static unsigned long decodeAvx2(
+                const std::uint8_t* source,
+                unsigned long       length,
+                std::uint8_t*       destination
+            ) {
+            const __m256i lowerNibbleTable = _mm256_setr_epi8(
+                0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A,
+                0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A
+            );
+            const __m256i upperNibbleTable = _mm256_setr_epi8(
+                0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10,
+                0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10
+            );
+            const __m256i rollTable = _mm256_setr_epi8(
+                0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0,
+                0, 16, 19, 4, -65, -65, -71, -71, 0, 0, 0, 0, 0, 0, 0, 0
+            );
+            const __m256i pack = _mm256_setr_epi8(
+                2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1,
+                2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13, 12, -1, -1, -1, -1
+            );
+            const __m256i laneMerge = _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 3, 7);
+            const __m256i nibble    = _mm256_set1_epi8(0x0F);
+
+            unsigned long consumed = 0;
+
+            // Each block writes 32 bytes but only 24 are valid.  We stop early enough that the extra bytes land in
+            // space that later output will fill.
+            while (length - consumed >= 48) {
+                __m256i input = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source + consumed));
+
+                __m256i upperNibbles = _mm256_and_si256(_mm256_srli_epi32(input, 4), nibble);
+                __m256i lowerNibbles = _mm256_and_si256(input, nibble);
+                __m256i lower        = _mm256_shuffle_epi8(lowerNibbleTable, lowerNibbles);
+                __m256i upper        = _mm256_shuffle_epi8(upperNibbleTable, upperNibbles);
+
+                if (!_mm256_testz_si256(lower, upper)) {
+                    break;
+                }
+
+                __m256i isSlash = _mm256_cmpeq_epi8(input, _mm256_set1_epi8('/'));
+                __m256i roll    = _mm256_shuffle_epi8(rollTable, _mm256_add_epi8(isSlash, upperNibbles));
+                __m256i values  = _mm256_add_epi8(input, roll);
+
+                __m256i merged = _mm256_maddubs_epi16(values, _mm256_set1_epi32(0x01400140));
+                __m256i output = _mm256_madd_epi16(merged, _mm256_set1_epi32(0x00011000));
+
+                output = _mm256_shuffle_epi8(output, pack);
+                output = _mm256_permutevar8x32_epi32(output, laneMerge);
+
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination), output);
+
+                consumed    += 32;
+                destination += 24;
+            }
+
+            return consumed;
+        }
+
+    #endif
+
+    Base64::Implementation Base64::implementation() {
+        #if (defined(REST_API_OUT_V1_BASE64_X86))
+            static const Implementation detected = (
+                  __builtin_cpu_supports("avx2")
+                ? Implementation::AVX2
+                : (__builtin_cpu_supports("ssse3") ? Implementation::SSSE3 : Implementation::SCALAR)
+            );
+        #else
+            static const Implementation detected = Implementation::SCALAR;
+        #endif
+
+        return detected;
+    }
+
+
+    char* Base64::encode(const char* data, unsigned long length, char* destination) {
+        const std::uint8_t* source   = reinterpret_cast<const std::uint8_t*>(data);
+        unsigned long       consumed = 0;
+
+        #if (defined(REST_API_OUT_V1_BASE64_X86))
+            switch (implementation()) {
+                case Implementation::AVX2: {
+                    consumed = encodeAvx2(source, length, destination);
+                    break;
+                }
+
+                case Implementation::SSSE3: {
+                    consumed = encodeSsse3(source, length, destination);
+                    break;
+                }
+
+                case Implementation::SCALAR: {
+                    break;
+                }
+            }
+        #endif
+
+        return encodeScalar(source + consumed, length - consumed, destination + 4 * (consumed / 3));
+    }
+
+
+    QByteArray Base64::encode(const QByteArray& data) {
+        unsigned long length = static_cast<unsigned long>(data.size());
+        QByteArray    result(static_cast<int>(encodedLength(length)), Qt::Uninitialized);
+
+        encode(data.constData(), length, result.data());
+        return result;
+    }
+
+
+    long Base64::decode(const char* data, unsigned long length, char* destination) {
+        const std::uint8_t* source   = reinterpret_cast<const std::uint8_t*>(data);
+        std::uint8_t*       output   = reinterpret_cast<std::uint8_t*>(destination);
+        unsigned long       consumed = 0;
+
+        #if (defined(REST_API_OUT_V1_BASE64_X86))
+            switch (implementation()) {
+                case Implementation::AVX2: {
+                    consumed = decodeAvx2(source, length, output);
+                    break;
+                }
+
+                case Implementation::SSSE3: {
+                    consumed = decodeSsse3(source, length, output);
+                    break;
+                }
+
+                case Implementation::SCALAR: {
+                    break;
+                }
+            }
+        #endif
+
+        long result = decodeScalar(source + consumed, length - consumed, output + 3 * (consumed / 4));
+        if (result >= 0) {
+            result += static_cast<long>(3 * (consumed / 4));
+        }
+
+        return result;
+    }
+
+
+    QByteArray Base64::decode(const QByteArray& data, bool* ok) {
+        unsigned long length = static_cast<unsigned long>(data.size());
+        QByteArray    result(static_cast<int>(maximumDecodedLength(length)), Qt::Uninitialized);
+
+        long decodedLength = decode(data.constData(), length, result.data());
+        if (decodedLength >= 0) {
+            result.truncate(static_cast<int>(decodedLength));
+        } else {
+            result.clear();
+        }
+
+        if (ok != nullptr) {
+            *ok = (decodedLength >= 0);
+        }
+
+        return result;
+    }
+}
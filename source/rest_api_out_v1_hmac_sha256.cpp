@@ -0,0 +1,244 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref RestApiOutV1::HmacSha256 class.
+***********************************************************************************************************************/
+
+#include <QByteArray>
+
+#include <cstdint>
+#include <cstring>
+
+#include "rest_api_out_v1_hmac_sha256.h"
+
+namespace RestApiOutV1 {
+    static const std::uint32_t roundConstants[64] = {
+        0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+        0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+        0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+        0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+        0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+        0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+        0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+        0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+    };
+
+    static const std::uint32_t initialState[8] = {
+        0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19
+    };
+
+    static inline std::uint32_t rotateRight(std::uint32_t value, unsigned count) {
+        return (value >> count) | (value << (32 - count));
+    }
+
+    const unsigned HmacSha256::blockSize  = 64;
+    const unsigned HmacSha256::digestSize = 32;
+
+    HmacSha256::HmacSha256() {
+        clear();
+    }
+
+
+    HmacSha256::HmacSha256(const QByteArray& key) {
+        setKey(key);
+    }
+
+
+    HmacSha256::HmacSha256(const HmacSha256& other) {
+        std::memcpy(innerState, other.innerState, sizeof(innerState));
+        std::memcpy(outerState, other.outerState, sizeof(outerState));
+    }
+
+
+    HmacSha256::~HmacSha256() {
+        clear();
+    }
+
+
+    void HmacSha256::setKey(const char* key, unsigned long keyLength) {
+        std::uint8_t paddedKey[blockSize];
+        std::memset(paddedKey, 0, blockSize);
+
+        if (keyLength > blockSize) {
+            std::uint32_t state[stateWords];
+            std::memcpy(state, initialState, sizeof(state));
+            finish(state, 0, reinterpret_cast<const std::uint8_t*>(key), keyLength, paddedKey);
+        } else {
+            std::memcpy(paddedKey, key, keyLength);
+        }
+
+        std::uint8_t block[blockSize];
+
+        for (unsigned i=0 ; i<blockSize ; ++i) {
+            block[i] = paddedKey[i] ^ 0x36;
+        }
+
+        std::memcpy(innerState, initialState, sizeof(innerState));
+        compress(innerState, block);
+
+        for (unsigned i=0 ; i<blockSize ; ++i) {
+            block[i] = paddedKey[i] ^ 0x5C;
+        }
+
+        std::memcpy(outerState, initialState, sizeof(outerState));
+        compress(outerState, block);
+
+        volatile std::uint8_t* scrubbedKey   = paddedKey;
+        volatile std::uint8_t* scrubbedBlock = block;
+        for (unsigned i=0 ; i<blockSize ; ++i) {
+            scrubbedKey[i]   = 0;
+            scrubbedBlock[i] = 0;
+        }
+    }
+
+
+    void HmacSha256::digest(const char* message, unsigned long long messageLength, char* digest) const {
+        std::uint8_t  innerDigest[32];
+        std::uint32_t state[stateWords];
+
+        std::memcpy(state, innerState, sizeof(state));
+        finish(state, blockSize, reinterpret_cast<const std::uint8_t*>(message), messageLength, innerDigest);
+
+        std::memcpy(state, outerState, sizeof(state));
+        finish(state, blockSize, innerDigest, sizeof(innerDigest), reinterpret_cast<std::uint8_t*>(digest));
+    }
+
+
+    QByteArray HmacSha256::digest(const QByteArray& message) const {
+        QByteArray result(static_cast<int>(digestSize), '\0');
+        digest(message.constData(), static_cast<unsigned long long>(message.size()), result.data());
+
+        return result;
+    }
+
+
+    HmacSha256& HmacSha256::operator=(const HmacSha256& other) {
+        std::memcpy(innerState, other.innerState, sizeof(innerState));
+        std::memcpy(outerState, other.outerState, sizeof(outerState));
+
+        return *this;
+    }
+
+
+    void HmacSha256::compress(std::uint32_t* state, const std::uint8_t* block) {
+        std::uint32_t w[64];
+
+        for (unsigned i=0 ; i<16 ; ++i) {
+            w[i] = (
+                  (static_cast<std::uint32_t>(block[4 * i + 0]) << 24)
+                | (static_cast<std::uint32_t>(block[4 * i + 1]) << 16)
+                | (static_cast<std::uint32_t>(block[4 * i + 2]) <<  8)
+                | (static_cast<std::uint32_t>(block[4 * i + 3])      )
+            );
+        }
+
+        for (unsigned i=16 ; i<64 ; ++i) {
+            std::uint32_t s0 = rotateRight(w[i - 15],  7) ^ rotateRight(w[i - 15], 18) ^ (w[i - 15] >>  3);
+            std::uint32_t s1 = rotateRight(w[i -  2], 17) ^ rotateRight(w[i -  2], 19) ^ (w[i -  2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        std::uint32_t a = state[0];
+        std::uint32_t b = state[1];
+        std::uint32_t c = state[2];
+        std::uint32_t d = state[3];
+        std::uint32_t e = state[4];
+        std::uint32_t f = state[5];
+        std::uint32_t g = state[6];
+        std::uint32_t h = state[7];
+
+        for (unsigned i=0 ; i<64 ; ++i) {
+            std::uint32_t s1    = rotateRight(e, 6) ^ rotateRight(e, 11) ^ rotateRight(e, 25);
+            std::uint32_t ch    = (e & f) ^ (~e & g);
+            std::uint32_t temp1 = h + s1 + ch + roundConstants[i] + w[i];
+            std::uint32_t s0    = rotateRight(a, 2) ^ rotateRight(a, 13) ^ rotateRight(a, 22);
+            std::uint32_t maj   = (a & b) ^ (a & c) ^ (b & c);
+            std::uint32_t temp2 = s0 + maj;
+
+            h = g;
+            g = f;
+            f = e;
+            e = d + temp1;
+            d = c;
+            c = b;
+            b = a;
+            a = temp1 + temp2;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+        state[5] += f;
+        state[6] += g;
+        state[7] += h;
+    }
+
+
+    void HmacSha256::finish(
+            std::uint32_t*      state,
+            unsigned long long  prefixLength,
+            const std::uint8_t* message,
+            unsigned long long  messageLength,
+            std::uint8_t*       digest
+        ) {
+        unsigned long long remaining = messageLength;
+        while (remaining >= blockSize) {
+            compress(state, message);
+            message   += blockSize;
+            remaining -= blockSize;
+        }
+
+        // The final one or two blocks hold the message tail, the 0x80 terminator and the message length in bits.
+        std::uint8_t tail[2 * 64];
+        unsigned     tailLength = (remaining + 9 > blockSize) ? 2 * blockSize : blockSize;
+
+        std::memset(tail, 0, tailLength);
+        std::memcpy(tail, message, static_cast<std::size_t>(remaining));
+        tail[remaining] = 0x80;
+
+        unsigned long long bitLength = (prefixLength + messageLength) * 8;
+        for (unsigned i=0 ; i<8 ; ++i) {
+            tail[tailLength - 1 - i] = static_cast<std::uint8_t>(bitLength >> (8 * i));
+        }
+
+        compress(state, tail);
+        if (tailLength > blockSize) {
+            compress(state, tail + blockSize);
+        }
+
+        for (unsigned i=0 ; i<stateWords ; ++i) {
+            digest[4 * i + 0] = static_cast<std::uint8_t>(state[i] >> 24);
+            digest[4 * i + 1] = static_cast<std::uint8_t>(state[i] >> 16);
+            digest[4 * i + 2] = static_cast<std::uint8_t>(state[i] >>  8);
+            digest[4 * i + 3] = static_cast<std::uint8_t>(state[i]      );
+        }
+    }
+
+
+    void HmacSha256::clear() {
+        volatile std::uint32_t* scrubbedInner = innerState;
+        volatile std::uint32_t* scrubbedOuter = outerState;
+        for (unsigned i=0 ; i<stateWords ; ++i) {
+            scrubbedInner[i] = 0;
+            scrubbedOuter[i] = 0;
+        }
+    }
+}
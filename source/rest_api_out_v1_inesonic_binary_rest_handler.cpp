@@ -26,9 +26,13 @@
 #include <QByteArray>
 #include <QNetworkRequest>
 #include <QNetworkReply>
+#include <QUrl>
+#include <QHash>
 #include <QVariant>
 
 #include <cstring>
+#include <algorithm>
+#include <functional>
 
 #include <crypto_aes_cbc_encryptor.h>
 #include <crypto_hmac.h>
@@ -46,7 +50,7 @@ namespace RestApiOutV1 {
         ),InesonicRestHandlerBase(
             server
         ) {
-        pendingReply = nullptr;
+        attachRequestContext(this);
     }
 
 
@@ -60,96 +64,165 @@ namespace RestApiOutV1 {
             secret,
             server
         ) {
-        pendingReply = nullptr;
+        attachRequestContext(this);
     }
 
 
     InesonicBinaryRestHandler::~InesonicBinaryRestHandler() {}
 
 
-    void InesonicBinaryRestHandler::post(const QString& endpoint, const QByteArray& binaryPayload) {
-        retriesRemaining = 1;
+    unsigned long long InesonicBinaryRestHandler::post(const QString& endpoint, const QByteArray& binaryPayload) {
+        return postPayload(endpoint, binaryPayload);
+    }
 
-        currentUrl = server()->schemeAndHost();
-        currentUrl.setPath(endpoint);
 
-        currentPayload = binaryPayload;
-        if (isTimestampAccurate()) {
-            timestampUpdated();
-        }
+    unsigned long long InesonicBinaryRestHandler::post(
+            const QString&          endpoint,
+            const QByteArray&       binaryPayload,
+            const ResponseCallback& responseCallback,
+            const FailureCallback&  failureCallback
+        ) {
+        return postPayload(
+            endpoint,
+            binaryPayload,
+            [this, responseCallback, failureCallback](unsigned long long requestId) {
+                registerCallbacks(requestId, responseCallback, failureCallback);
+            }
+        );
     }
 
 
-    void InesonicBinaryRestHandler::responseReceived() {
-        QNetworkReply::NetworkError networkError = pendingReply->error();
+    void InesonicBinaryRestHandler::submit(
+            const QString&          endpoint,
+            const QByteArray&       binaryPayload,
+            const ResponseCallback& responseCallback,
+            const FailureCallback&  failureCallback,
+            const Server::Executor& executor
+        ) {
+        ResponseCallback responseHandler = responseCallback;
+        FailureCallback  failureHandler  = failureCallback;
+
+        if (executor) {
+            if (responseCallback) {
+                responseHandler = [executor, responseCallback](
+                        unsigned long long requestId,
+                        const QByteArray&  binaryData,
+                        const QString&     contentType
+                    ) {
+                    executor([responseCallback, requestId, binaryData, contentType]() {
+                        responseCallback(requestId, binaryData, contentType);
+                    });
+                };
+            }
+
+            if (failureCallback) {
+                failureHandler = [executor, failureCallback](unsigned long long requestId, const QString& errorString) {
+                    executor([failureCallback, requestId, errorString]() {
+                        failureCallback(requestId, errorString);
+                    });
+                };
+            }
+        }
 
-        pendingReply->deleteLater();
+        submitTask([this, endpoint, binaryPayload, responseHandler, failureHandler]() {
+            postPayload(endpoint, binaryPayload, [this, responseHandler, failureHandler](unsigned long long requestId) {
+                registerCallbacks(requestId, responseHandler, failureHandler);
+            });
+        });
+    }
 
-        if (networkError == QNetworkReply::NetworkError::NoError) {
-            QByteArray receivedData       = pendingReply->readAll();
-            QVariant   contentTypeVariant = pendingReply->header(QNetworkRequest::KnownHeaders::ContentTypeHeader);
-            QString    contentType        = contentTypeVariant.isValid() ? contentTypeVariant.toString() : QString();
 
-            pendingReply = nullptr;
+    void InesonicBinaryRestHandler::processResponse(
+            unsigned long long requestId,
+            const QByteArray&  binaryData,
+            const QString&     contentType
+        ) {
+        emit responseReceived(requestId, binaryData, contentType);
+    }
 
-            processResponse(receivedData, contentType);
-        } else if (networkError == QNetworkReply::NetworkError::AuthenticationRequiredError &&
-                   retriesRemaining > 0                                                        ) {
-            pendingReply = nullptr;
 
-            --retriesRemaining;
-            updateTimeDelta();
-        } else {
-            QString errorMessage = pendingReply->errorString();
-            pendingReply = nullptr;
+    void InesonicBinaryRestHandler::processRequestFailed(unsigned long long requestId, const QString& errorString) {
+        emit requestFailed(requestId, errorString);
+    }
 
-            processRequestFailed(errorMessage);
-        }
+
+    QByteArray InesonicBinaryRestHandler::buildMessage(const QByteArray& encodedPayload, const QByteArray& hash) {
+        return encodedPayload + hash;
     }
 
 
-    void InesonicBinaryRestHandler::processResponse(const QByteArray& jsonData, const QString& contentType) {
-        emit responseReceived(jsonData, contentType);
+    QString InesonicBinaryRestHandler::messageContentType() const {
+        return QString("application/octet-stream");
     }
 
 
-    void InesonicBinaryRestHandler::processRequestFailed(const QString& errorString) {
-        emit requestFailed(errorString);
+    void InesonicBinaryRestHandler::processReply(unsigned long long requestId, QNetworkReply* reply) {
+        QByteArray receivedData       = reply->readAll();
+        QVariant   contentTypeVariant = reply->header(QNetworkRequest::KnownHeaders::ContentTypeHeader);
+        QString    contentType        = contentTypeVariant.isValid() ? contentTypeVariant.toString() : QString();
+
+        if (requestCallbacks.isEmpty()) {
+            processResponse(requestId, receivedData, contentType);
+        } else {
+            QHash<unsigned long long, Callbacks>::iterator it = requestCallbacks.find(requestId);
+            if (it != requestCallbacks.end()) {
+                ResponseCallback responseCallback = it.value().responseCallback;
+                requestCallbacks.erase(it);
+
+                if (responseCallback) {
+                    responseCallback(requestId, receivedData, contentType);
+                }
+            } else {
+                processResponse(requestId, receivedData, contentType);
+            }
+        }
     }
 
 
-    void InesonicBinaryRestHandler::timestampUpdated() {
-        if (pendingReply != nullptr) {
-            pendingReply->deleteLater();
+    void InesonicBinaryRestHandler::processFailure(unsigned long long requestId, const QString& errorString) {
+        if (requestCallbacks.isEmpty()) {
+            processRequestFailed(requestId, errorString);
+        } else {
+            QHash<unsigned long long, Callbacks>::iterator it = requestCallbacks.find(requestId);
+            if (it != requestCallbacks.end()) {
+                FailureCallback failureCallback = it.value().failureCallback;
+                requestCallbacks.erase(it);
+
+                if (failureCallback) {
+                    failureCallback(requestId, errorString);
+                } else {
+                    processRequestFailed(requestId, errorString);
+                }
+            } else {
+                processRequestFailed(requestId, errorString);
+            }
         }
+    }
 
-        QByteArray hash    = calculateHash(currentPayload);
-        QByteArray message = currentPayload + hash;
 
-        QNetworkRequest request(currentUrl);
-        request.setHeader(QNetworkRequest::KnownHeaders::UserAgentHeader, server()->userAgent());
-        request.setHeader(QNetworkRequest::KnownHeaders::ContentTypeHeader, "application/octet-stream");
-        request.setHeader(QNetworkRequest::KnownHeaders::ContentLengthHeader, message.size());
-        request.setTransferTimeout();
+    unsigned long long InesonicBinaryRestHandler::postPayload(
+            const QString&      endpoint,
+            const QByteArray&   payload,
+            const RequestSetup& setup
+        ) {
+        selectServer();
 
-        pendingReply = server()->post(request, message);
-        pendingReply->setParent(this);
+        QUrl url = server()->schemeAndHost();
+        url.setPath(endpoint);
 
-        connect(
-            pendingReply,
-            &QNetworkReply::finished,
-            this,
-            static_cast<void (InesonicBinaryRestHandler::*)()>(&InesonicBinaryRestHandler::responseReceived)
-        );
+        return startRequest(endpoint, url, payload, setup);
     }
 
 
-    void InesonicBinaryRestHandler::timestampUpdateFailed() {
-        if (pendingReply != nullptr) {
-            pendingReply->deleteLater();
-            pendingReply = nullptr;
-        }
+    void InesonicBinaryRestHandler::registerCallbacks(
+            unsigned long long      requestId,
+            const ResponseCallback& responseCallback,
+            const FailureCallback&  failureCallback
+        ) {
+        Callbacks callbacks;
+        callbacks.responseCallback = responseCallback;
+        callbacks.failureCallback  = failureCallback;
 
-        processRequestFailed(QString("Failed to sync with server."));
+        requestCallbacks.insert(requestId, callbacks);
     }
 }
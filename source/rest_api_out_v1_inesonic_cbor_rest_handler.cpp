@@ -0,0 +1,371 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref RestApiOutV1::InesonicCborRestHandler class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QObject>
+#include <QString>
+#include <QByteArray>
+#include <QCborValue>
+#include <QCborMap>
+#include <QCborArray>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QUrl>
+#include <QHash>
+
+#include <functional>
+
+#include <cstdint>
+#include <cstring>
+
+#include "rest_api_out_v1_server.h"
+#include "rest_api_out_v1_inesonic_rest_handler_base.h"
+#include "rest_api_out_v1_inesonic_cbor_rest_handler.h"
+
+namespace RestApiOutV1 {
+    static const std::uint8_t cborMapOfTwo   = 0xA2;
+    static const std::uint8_t cborByteString = 0x40;
+    static const char         cborDataKey[]  = { '\x64', 'd', 'a', 't', 'a' };
+    static const char         cborHashKey[]  = { '\x64', 'h', 'a', 's', 'h' };
+    static const unsigned     cborKeyLength  = sizeof(cborDataKey);
+
+    /**
+     * Function that calculates the length of the header for a CBOR byte string.
+     *
+     * \param[in] length The length of the byte string, in bytes.
+     *
+     * \return Returns the length of the header, in bytes.
+     */
+    static inline unsigned byteStringHeaderLength(unsigned long long length) {
+        unsigned result;
+
+        if (length < 24) {
+            result = 1;
+        } else if (length <= 0xFF) {
+            result = 2;
+        } else if (length <= 0xFFFF) {
+            result = 3;
+        } else if (length <= 0xFFFFFFFF) {
+            result = 5;
+        } else {
+            result = 9;
+        }
+
+        return result;
+    }
+
+
+    /**
+     * Function that writes the header for a CBOR byte string.
+     *
+     * \param[in] length      The length of the byte string, in bytes.
+     *
+     * \param[in] destination Buffer to receive the header.
+     *
+     * \return Returns a pointer just past the header.
+     */
+    static char* writeByteStringHeader(unsigned long long length, char* destination) {
+        unsigned headerLength = byteStringHeaderLength(length);
+
+        if (headerLength == 1) {
+            *destination++ = static_cast<char>(cborByteString | length);
+        } else {
+            // Additional information values 24 through 27 select a 1, 2, 4, or 8 byte big endian length.
+            unsigned lengthBytes = headerLength - 1;
+            unsigned information = 24;
+            while ((1U << (information - 24)) != lengthBytes) {
+                ++information;
+            }
+
+            *destination++ = static_cast<char>(cborByteString | information);
+            for (unsigned i=lengthBytes ; i>0 ; --i) {
+                *destination++ = static_cast<char>(length >> (8 * (i - 1)));
+            }
+        }
+
+        return destination;
+    }
+
+
+    InesonicCborRestHandler::InesonicCborRestHandler(
+            Server*  server,
+            QObject* parent
+        ):QObject(
+            parent
+        ),InesonicRestHandlerBase(
+            server
+        ) {
+        attachRequestContext(this);
+    }
+
+
+    InesonicCborRestHandler::InesonicCborRestHandler(
+            const QByteArray& secret,
+            Server*           server,
+            QObject*          parent
+        ):QObject(
+            parent
+        ),InesonicRestHandlerBase(
+            secret,
+            server
+        ) {
+        attachRequestContext(this);
+    }
+
+
+    InesonicCborRestHandler::~InesonicCborRestHandler() {}
+
+
+    unsigned long long InesonicCborRestHandler::post(const QString& endpoint, const QCborValue& cborData) {
+        return postPayload(endpoint, cborData.toCbor());
+    }
+
+
+    unsigned long long InesonicCborRestHandler::post(const QString& endpoint, const QCborMap& cborData) {
+        return post(endpoint, QCborValue(cborData));
+    }
+
+
+    unsigned long long InesonicCborRestHandler::post(const QString& endpoint, const QCborArray& cborData) {
+        return post(endpoint, QCborValue(cborData));
+    }
+
+
+    unsigned long long InesonicCborRestHandler::post(
+            const QString&          endpoint,
+            const QCborValue&       cborData,
+            const ResponseCallback& responseCallback,
+            const FailureCallback&  failureCallback
+        ) {
+        return postPayload(
+            endpoint,
+            cborData.toCbor(),
+            [this, responseCallback, failureCallback](unsigned long long requestId) {
+                registerCallbacks(requestId, responseCallback, failureCallback);
+            }
+        );
+    }
+
+
+    unsigned long long InesonicCborRestHandler::post(
+            const QString&          endpoint,
+            const QCborMap&         cborData,
+            const ResponseCallback& responseCallback,
+            const FailureCallback&  failureCallback
+        ) {
+        return post(endpoint, QCborValue(cborData), responseCallback, failureCallback);
+    }
+
+
+    unsigned long long InesonicCborRestHandler::post(
+            const QString&          endpoint,
+            const QCborArray&       cborData,
+            const ResponseCallback& responseCallback,
+            const FailureCallback&  failureCallback
+        ) {
+        return post(endpoint, QCborValue(cborData), responseCallback, failureCallback);
+    }
+
+
+    void InesonicCborRestHandler::submit(
+            const QString&          endpoint,
+            const QCborValue&       cborData,
+            const ResponseCallback& responseCallback,
+            const FailureCallback&  failureCallback,
+            const Server::Executor& executor
+        ) {
+        QByteArray       payload         = cborData.toCbor();
+        ResponseCallback responseHandler = responseCallback;
+        FailureCallback  failureHandler  = failureCallback;
+
+        if (executor) {
+            if (responseCallback) {
+                responseHandler = [executor, responseCallback](
+                        unsigned long long requestId,
+                        const QCborValue&  response
+                    ) {
+                    executor([responseCallback, requestId, response]() {
+                        responseCallback(requestId, response);
+                    });
+                };
+            }
+
+            if (failureCallback) {
+                failureHandler = [executor, failureCallback](unsigned long long requestId, const QString& errorString) {
+                    executor([failureCallback, requestId, errorString]() {
+                        failureCallback(requestId, errorString);
+                    });
+                };
+            }
+        }
+
+        submitTask([this, endpoint, payload, responseHandler, failureHandler]() {
+            postPayload(endpoint, payload, [this, responseHandler, failureHandler](unsigned long long requestId) {
+                registerCallbacks(requestId, responseHandler, failureHandler);
+            });
+        });
+    }
+
+
+    void InesonicCborRestHandler::submit(
+            const QString&          endpoint,
+            const QCborMap&         cborData,
+            const ResponseCallback& responseCallback,
+            const FailureCallback&  failureCallback,
+            const Server::Executor& executor
+        ) {
+        submit(endpoint, QCborValue(cborData), responseCallback, failureCallback, executor);
+    }
+
+
+    void InesonicCborRestHandler::submit(
+            const QString&          endpoint,
+            const QCborArray&       cborData,
+            const ResponseCallback& responseCallback,
+            const FailureCallback&  failureCallback,
+            const Server::Executor& executor
+        ) {
+        submit(endpoint, QCborValue(cborData), responseCallback, failureCallback, executor);
+    }
+
+
+    void InesonicCborRestHandler::processCborResponse(unsigned long long requestId, const QCborValue& cborData) {
+        emit cborResponse(requestId, cborData);
+    }
+
+
+    void InesonicCborRestHandler::processRequestFailed(unsigned long long requestId, const QString& errorString) {
+        emit requestFailed(requestId, errorString);
+    }
+
+
+    QByteArray InesonicCborRestHandler::encodePayload(const QByteArray& payload) {
+        // The envelope is a definite length map holding the "data" and "hash" byte strings.  The hash length is
+        // fixed so the envelope, up to the hash bytes, can be written once per request.
+        unsigned long payloadLength = static_cast<unsigned long>(payload.size());
+        unsigned long resultLength  = (
+              1
+            + cborKeyLength
+            + byteStringHeaderLength(payloadLength)
+            + payloadLength
+            + cborKeyLength
+            + byteStringHeaderLength(hashLength)
+        );
+        QByteArray    result(static_cast<int>(resultLength), Qt::Uninitialized);
+
+        char* destination = result.data();
+        *destination++ = static_cast<char>(cborMapOfTwo);
+
+        std::memcpy(destination, cborDataKey, cborKeyLength);
+        destination = writeByteStringHeader(payloadLength, destination + cborKeyLength);
+
+        std::memcpy(destination, payload.constData(), payloadLength);
+        destination += payloadLength;
+
+        std::memcpy(destination, cborHashKey, cborKeyLength);
+        writeByteStringHeader(hashLength, destination + cborKeyLength);
+
+        return result;
+    }
+
+
+    QByteArray InesonicCborRestHandler::buildMessage(const QByteArray& encodedPayload, const QByteArray& hash) {
+        Q_ASSERT(static_cast<unsigned>(hash.size()) == hashLength);
+        return encodedPayload + hash;
+    }
+
+
+    QString InesonicCborRestHandler::messageContentType() const {
+        return QString("application/cbor");
+    }
+
+
+    void InesonicCborRestHandler::processReply(unsigned long long requestId, QNetworkReply* reply) {
+        QByteArray receivedData = reply->readAll();
+
+        QCborParserError parseError;
+        QCborValue       cborValue = QCborValue::fromCbor(receivedData, &parseError);
+        if (parseError.error == QCborError::NoError) {
+            if (requestCallbacks.isEmpty()) {
+                processCborResponse(requestId, cborValue);
+            } else {
+                QHash<unsigned long long, Callbacks>::iterator it = requestCallbacks.find(requestId);
+                if (it != requestCallbacks.end()) {
+                    ResponseCallback responseCallback = it.value().responseCallback;
+                    requestCallbacks.erase(it);
+
+                    if (responseCallback) {
+                        responseCallback(requestId, cborValue);
+                    }
+                } else {
+                    processCborResponse(requestId, cborValue);
+                }
+            }
+        } else {
+            processFailure(requestId, QString("Response not CBOR format"));
+        }
+    }
+
+
+    void InesonicCborRestHandler::processFailure(unsigned long long requestId, const QString& errorString) {
+        if (requestCallbacks.isEmpty()) {
+            processRequestFailed(requestId, errorString);
+        } else {
+            QHash<unsigned long long, Callbacks>::iterator it = requestCallbacks.find(requestId);
+            if (it != requestCallbacks.end()) {
+                FailureCallback failureCallback = it.value().failureCallback;
+                requestCallbacks.erase(it);
+
+                if (failureCallback) {
+                    failureCallback(requestId, errorString);
+                } else {
+                    processRequestFailed(requestId, errorString);
+                }
+            } else {
+                processRequestFailed(requestId, errorString);
+            }
+        }
+    }
+
+
+    unsigned long long InesonicCborRestHandler::postPayload(
+            const QString&      endpoint,
+            const QByteArray&   payload,
+            const RequestSetup& setup
+        ) {
+        selectServer();
+        return startRequest(endpoint, QUrl(server()->schemeAndHost().toString() + endpoint), payload, setup);
+    }
+
+
+    void InesonicCborRestHandler::registerCallbacks(
+            unsigned long long      requestId,
+            const ResponseCallback& responseCallback,
+            const FailureCallback&  failureCallback
+        ) {
+        Callbacks callbacks;
+        callbacks.responseCallback = responseCallback;
+        callbacks.failureCallback  = failureCallback;
+
+        requestCallbacks.insert(requestId, callbacks);
+    }
+}
@@ -0,0 +1,283 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref RestApiOutV1::InesonicLoopbackReceiver class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QString>
+#include <QByteArray>
+#include <QVariant>
+#include <QHash>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QJsonParseError>
+#include <QCborValue>
+#include <QCborMap>
+#include <QNetworkRequest>
+
+#include <cstdint>
+#include <cstring>
+
+#include "rest_api_out_v1_server.h"
+#include "rest_api_out_v1_base64.h"
+#include "rest_api_out_v1_hmac_sha256.h"
+#include "rest_api_out_v1_loopback_transport.h"
+#include "rest_api_out_v1_inesonic_rest_handler_base.h"
+#include "rest_api_out_v1_inesonic_loopback_receiver.h"
+
+namespace RestApiOutV1 {
+    InesonicLoopbackReceiver::InesonicLoopbackReceiver(
+            const QByteArray& defaultSecret
+        ):currentDefaultSecret(
+            defaultSecret
+        ),currentTimeDeltaSlug(
+            Server::defaultTimeDeltaSlug
+        ) {
+        currentClockOffset            = 0;
+        currentNumberAcceptedRequests = 0;
+        currentNumberRejectedRequests = 0;
+    }
+
+
+    InesonicLoopbackReceiver::~InesonicLoopbackReceiver() {}
+
+
+    void InesonicLoopbackReceiver::setDefaultSecret(const QByteArray& newDefaultSecret) {
+        currentDefaultSecret = newDefaultSecret;
+    }
+
+
+    void InesonicLoopbackReceiver::registerEndpoint(
+            const QString&    endpoint,
+            const Handler&    handler,
+            const QByteArray& secret
+        ) {
+        Endpoint entry;
+        entry.handler = handler;
+        entry.secret  = secret;
+
+        endpoints.insert(endpoint, entry);
+    }
+
+
+    void InesonicLoopbackReceiver::unregisterEndpoint(const QString& endpoint) {
+        endpoints.remove(endpoint);
+    }
+
+
+    void InesonicLoopbackReceiver::setTimeDeltaSlug(const QString& newTimeDeltaSlug) {
+        currentTimeDeltaSlug = newTimeDeltaSlug;
+    }
+
+
+    const QString& InesonicLoopbackReceiver::timeDeltaSlug() const {
+        return currentTimeDeltaSlug;
+    }
+
+
+    void InesonicLoopbackReceiver::setClockOffset(long long newClockOffset) {
+        currentClockOffset = newClockOffset;
+    }
+
+
+    long long InesonicLoopbackReceiver::clockOffset() const {
+        return currentClockOffset;
+    }
+
+
+    unsigned long long InesonicLoopbackReceiver::numberAcceptedRequests() const {
+        return currentNumberAcceptedRequests;
+    }
+
+
+    unsigned long long InesonicLoopbackReceiver::numberRejectedRequests() const {
+        return currentNumberRejectedRequests;
+    }
+
+
+    LoopbackTransport::Receiver::Response InesonicLoopbackReceiver::processRequest(
+            const QNetworkRequest& request,
+            const QByteArray&      payload
+        ) {
+        Response response;
+
+        QString endpoint = request.url().path();
+        if (endpoint == currentTimeDeltaSlug) {
+            response = processTimeDelta(payload);
+        } else {
+            QHash<QString, Endpoint>::const_iterator it = endpoints.constFind(endpoint);
+            if (it != endpoints.constEnd()) {
+                const QByteArray& secret = it.value().secret.isEmpty() ? currentDefaultSecret : it.value().secret;
+
+                QByteArray data;
+                QByteArray hash;
+
+                if (!unpackMessage(request, payload, data, hash)) {
+                    ++currentNumberRejectedRequests;
+                    response = jsonResponse(400, QByteArray("{\"status\":\"failed, malformed message\"}"));
+                } else if (!hashValid(data, hash, secret)) {
+                    ++currentNumberRejectedRequests;
+                    response = jsonResponse(401, QByteArray("{\"status\":\"failed, invalid hash\"}"));
+                } else {
+                    ++currentNumberAcceptedRequests;
+                    response = it.value().handler(endpoint, data);
+                }
+            } else {
+                response = jsonResponse(404, QByteArray("{\"status\":\"failed, unknown endpoint\"}"));
+            }
+        }
+
+        return response;
+    }
+
+
+    LoopbackTransport::Receiver::Response InesonicLoopbackReceiver::processTimeDelta(
+            const QByteArray& payload
+        ) const {
+        Response response;
+
+        QJsonParseError parseError;
+        QJsonDocument   document       = QJsonDocument::fromJson(payload, &parseError);
+        QJsonValue      timestampValue = document.isObject() ? document.object().value("timestamp") : QJsonValue();
+
+        if (parseError.error == QJsonParseError::ParseError::NoError && timestampValue.isDouble()) {
+            double serverTime = (QDateTime::currentMSecsSinceEpoch() + currentClockOffset) / 1000.0;
+
+            QJsonObject responseObject;
+            responseObject.insert("status", "OK");
+            responseObject.insert("time_delta", serverTime - timestampValue.toDouble());
+
+            response = jsonResponse(200, QJsonDocument(responseObject).toJson(QJsonDocument::JsonFormat::Compact));
+        } else {
+            response = jsonResponse(400, QByteArray("{\"status\":\"failed, malformed message\"}"));
+        }
+
+        return response;
+    }
+
+
+    bool InesonicLoopbackReceiver::unpackMessage(
+            const QNetworkRequest& request,
+            const QByteArray&      message,
+            QByteArray&            payload,
+            QByteArray&            hash
+        ) {
+        bool success = false;
+
+        QVariant contentTypeVariant = request.header(QNetworkRequest::KnownHeaders::ContentTypeHeader);
+        QString  contentType        = contentTypeVariant.isValid() ? contentTypeVariant.toString() : QString();
+
+        if (request.hasRawHeader(InesonicRestHandlerBase::signatureHeader)) {
+            payload = message;
+            hash    = Base64::decode(request.rawHeader(InesonicRestHandlerBase::signatureHeader), &success);
+        } else if (contentType == QString("application/json")) {
+            QJsonParseError parseError;
+            QJsonDocument   document = QJsonDocument::fromJson(message, &parseError);
+
+            if (parseError.error == QJsonParseError::ParseError::NoError && document.isObject()) {
+                QJsonObject envelope  = document.object();
+                QJsonValue  dataValue = envelope.value("data");
+                QJsonValue  hashValue = envelope.value("hash");
+
+                if (envelope.size() == 2 && dataValue.isString() && hashValue.isString()) {
+                    bool dataOk;
+                    bool hashOk;
+
+                    payload = Base64::decode(dataValue.toString().toLatin1(), &dataOk);
+                    hash    = Base64::decode(hashValue.toString().toLatin1(), &hashOk);
+                    success = dataOk && hashOk;
+                }
+            }
+        } else if (contentType == QString("application/cbor")) {
+            QCborParserError parseError;
+            QCborValue       document = QCborValue::fromCbor(message, &parseError);
+
+            if (parseError.error == QCborError::NoError && document.isMap()) {
+                QCborMap   envelope  = document.toMap();
+                QCborValue dataValue = envelope.value(QString("data"));
+                QCborValue hashValue = envelope.value(QString("hash"));
+
+                if (envelope.size() == 2 && dataValue.isByteArray() && hashValue.isByteArray()) {
+                    payload = dataValue.toByteArray();
+                    hash    = hashValue.toByteArray();
+                    success = true;
+                }
+            }
+        } else if (static_cast<unsigned>(message.size()) >= HmacSha256::digestSize) {
+            payload = message.left(message.size() - HmacSha256::digestSize);
+            hash    = message.right(HmacSha256::digestSize);
+            success = true;
+        }
+
+        return success;
+    }
+
+
+    bool InesonicLoopbackReceiver::hashValid(
+            const QByteArray& payload,
+            const QByteArray& hash,
+            const QByteArray& secret
+        ) const {
+        bool valid = false;
+
+        unsigned secretLength = InesonicRestHandlerBase::secretLength;
+        if (static_cast<unsigned>(secret.size()) == secretLength &&
+            static_cast<unsigned>(hash.size()) == HmacSha256::digestSize) {
+            long long          serverTime = QDateTime::currentMSecsSinceEpoch() + currentClockOffset;
+            unsigned long long window     = serverTime / InesonicRestHandlerBase::signingWindow;
+
+            // The key matches the key built by the handlers: the secret followed by the window number.
+            QByteArray key(static_cast<int>(HmacSha256::blockSize), Qt::Uninitialized);
+            std::memcpy(key.data(), secret.constData(), secretLength);
+
+            for (unsigned long long candidate=window-1 ; !valid && candidate<=window+1 ; ++candidate) {
+                std::uint64_t windowValue = candidate;
+                std::memcpy(key.data() + secretLength, &windowValue, sizeof(windowValue));
+
+                QByteArray expected = HmacSha256(key).digest(payload);
+
+                unsigned char difference = 0;
+                for (unsigned i=0 ; i<HmacSha256::digestSize ; ++i) {
+                    difference |= static_cast<unsigned char>(expected.at(i) ^ hash.at(i));
+                }
+
+                valid = (difference == 0);
+            }
+        }
+
+        return valid;
+    }
+
+
+    LoopbackTransport::Receiver::Response InesonicLoopbackReceiver::jsonResponse(
+            int               statusCode,
+            const QByteArray& body
+        ) {
+        Response response;
+
+        response.statusCode  = statusCode;
+        response.contentType = QByteArray("application/json");
+        response.body        = body;
+
+        return response;
+    }
+}
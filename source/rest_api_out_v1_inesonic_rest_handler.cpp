@@ -29,17 +29,31 @@
 #include <QJsonParseError>
 #include <QNetworkRequest>
 #include <QNetworkReply>
+#include <QUrl>
+#include <QHash>
+
+#include <functional>
 
 #include <cstring>
+#include <algorithm>
 
 #include <crypto_aes_cbc_encryptor.h>
 #include <crypto_hmac.h>
 
 #include "rest_api_out_v1_server.h"
+#include "rest_api_out_v1_base64.h"
 #include "rest_api_out_v1_inesonic_rest_handler_base.h"
 #include "rest_api_out_v1_inesonic_rest_handler.h"
 
 namespace RestApiOutV1 {
+    static const char     envelopeDataPrefix[]     = "{\"data\":\"";
+    static const unsigned envelopeDataPrefixLength = sizeof(envelopeDataPrefix) - 1;
+    static const char     envelopeHashPrefix[]     = "\",\"hash\":\"";
+    static const unsigned envelopeHashPrefixLength = sizeof(envelopeHashPrefix) - 1;
+    static const char     envelopeSuffix[]         = "\"}";
+    static const unsigned envelopeSuffixLength     = sizeof(envelopeSuffix) - 1;
+
+
     InesonicRestHandler::InesonicRestHandler(
             Server*  server,
             QObject* parent
@@ -48,7 +62,7 @@ namespace RestApiOutV1 {
         ),InesonicRestHandlerBase(
             server
         ) {
-        pendingReply = nullptr;
+        attachRequestContext(this);
     }
 
 
@@ -62,107 +76,245 @@ namespace RestApiOutV1 {
             secret,
             server
         ) {
-        pendingReply = nullptr;
+        attachRequestContext(this);
     }
 
 
     InesonicRestHandler::~InesonicRestHandler() {}
 
 
-    void InesonicRestHandler::post(const QString& endpoint, const QJsonDocument& jsonData) {
-        retriesRemaining = 1;
+    unsigned long long InesonicRestHandler::post(const QString& endpoint, const QJsonDocument& jsonData) {
+        return postPayload(endpoint, jsonData.toJson(QJsonDocument::JsonFormat::Compact));
+    }
 
-        currentUrl     = QUrl(server()->schemeAndHost().toString() + endpoint);
-        currentPayload = jsonData.toJson(QJsonDocument::JsonFormat::Compact);
-        if (isTimestampAccurate()) {
-            timestampUpdated();
-        }
+
+    unsigned long long InesonicRestHandler::post(const QString& endpoint, const QJsonObject& jsonData) {
+        return post(endpoint, QJsonDocument(jsonData));
     }
 
 
-    void InesonicRestHandler::post(const QString& endpoint, const QJsonObject& jsonData) {
-        post(endpoint, QJsonDocument(jsonData));
+    unsigned long long InesonicRestHandler::post(const QString& endpoint, const QJsonArray& jsonData) {
+        return post(endpoint, QJsonDocument(jsonData));
     }
 
 
-    void InesonicRestHandler::post(const QString& endpoint, const QJsonArray& jsonData) {
-        post(endpoint, QJsonDocument(jsonData));
+    unsigned long long InesonicRestHandler::post(
+            const QString&          endpoint,
+            const QJsonDocument&    jsonData,
+            const ResponseCallback& responseCallback,
+            const FailureCallback&  failureCallback
+        ) {
+        return postPayload(
+            endpoint,
+            jsonData.toJson(QJsonDocument::JsonFormat::Compact),
+            [this, responseCallback, failureCallback](unsigned long long requestId) {
+                registerCallbacks(requestId, responseCallback, failureCallback);
+            }
+        );
     }
 
 
-    void InesonicRestHandler::responseReceived() {
-        QNetworkReply::NetworkError networkError = pendingReply->error();
+    unsigned long long InesonicRestHandler::post(
+            const QString&          endpoint,
+            const QJsonObject&      jsonData,
+            const ResponseCallback& responseCallback,
+            const FailureCallback&  failureCallback
+        ) {
+        return post(endpoint, QJsonDocument(jsonData), responseCallback, failureCallback);
+    }
 
-        pendingReply->deleteLater();
 
-        if (networkError == QNetworkReply::NetworkError::NoError) {
-            QByteArray receivedData = pendingReply->readAll();
-            pendingReply = nullptr;
+    unsigned long long InesonicRestHandler::post(
+            const QString&          endpoint,
+            const QJsonArray&       jsonData,
+            const ResponseCallback& responseCallback,
+            const FailureCallback&  failureCallback
+        ) {
+        return post(endpoint, QJsonDocument(jsonData), responseCallback, failureCallback);
+    }
 
-            QJsonParseError parseError;
-            QJsonDocument   jsonDocument = QJsonDocument::fromJson(receivedData, &parseError);
-            if (parseError.error == QJsonParseError::NoError) {
-                processJsonResponse(jsonDocument);
-            } else {
-                processRequestFailed(QString("Response not JSON format"));
-            }
-        } else if (networkError == QNetworkReply::NetworkError::AuthenticationRequiredError &&
-                   retriesRemaining > 0                                                        ) {
-            pendingReply = nullptr;
 
-            --retriesRemaining;
-            updateTimeDelta();
-        } else {
-            QString errorMessage = pendingReply->errorString();
-            pendingReply = nullptr;
+    void InesonicRestHandler::submit(
+            const QString&          endpoint,
+            const QJsonDocument&    jsonData,
+            const ResponseCallback& responseCallback,
+            const FailureCallback&  failureCallback,
+            const Server::Executor& executor
+        ) {
+        QByteArray       payload         = jsonData.toJson(QJsonDocument::JsonFormat::Compact);
+        ResponseCallback responseHandler = responseCallback;
+        FailureCallback  failureHandler  = failureCallback;
+
+        if (executor) {
+            if (responseCallback) {
+                responseHandler = [executor, responseCallback](
+                        unsigned long long   requestId,
+                        const QJsonDocument& response
+                    ) {
+                    executor([responseCallback, requestId, response]() {
+                        responseCallback(requestId, response);
+                    });
+                };
+            }
 
-            processRequestFailed(errorMessage);
+            if (failureCallback) {
+                failureHandler = [executor, failureCallback](unsigned long long requestId, const QString& errorString) {
+                    executor([failureCallback, requestId, errorString]() {
+                        failureCallback(requestId, errorString);
+                    });
+                };
+            }
         }
+
+        submitTask([this, endpoint, payload, responseHandler, failureHandler]() {
+            postPayload(endpoint, payload, [this, responseHandler, failureHandler](unsigned long long requestId) {
+                registerCallbacks(requestId, responseHandler, failureHandler);
+            });
+        });
     }
 
 
-    void InesonicRestHandler::processJsonResponse(const QJsonDocument& jsonData) {
-        emit jsonResponse(jsonData);
+    void InesonicRestHandler::submit(
+            const QString&          endpoint,
+            const QJsonObject&      jsonData,
+            const ResponseCallback& responseCallback,
+            const FailureCallback&  failureCallback,
+            const Server::Executor& executor
+        ) {
+        submit(endpoint, QJsonDocument(jsonData), responseCallback, failureCallback, executor);
     }
 
 
-    void InesonicRestHandler::processRequestFailed(const QString& errorString) {
-        emit requestFailed(errorString);
+    void InesonicRestHandler::submit(
+            const QString&          endpoint,
+            const QJsonArray&       jsonData,
+            const ResponseCallback& responseCallback,
+            const FailureCallback&  failureCallback,
+            const Server::Executor& executor
+        ) {
+        submit(endpoint, QJsonDocument(jsonData), responseCallback, failureCallback, executor);
     }
 
 
-    void InesonicRestHandler::timestampUpdated() {
-        if (pendingReply != nullptr) {
-            pendingReply->deleteLater();
-        }
+    void InesonicRestHandler::processJsonResponse(unsigned long long requestId, const QJsonDocument& jsonData) {
+        emit jsonResponse(requestId, jsonData);
+    }
 
-        QByteArray hash = calculateHash(currentPayload);
 
-        QJsonObject jsonMessage;
-        jsonMessage.insert("data", QString::fromLatin1(currentPayload.toBase64()));
-        jsonMessage.insert("hash", QString::fromLatin1(hash.toBase64()));
+    void InesonicRestHandler::processRequestFailed(unsigned long long requestId, const QString& errorString) {
+        emit requestFailed(requestId, errorString);
+    }
 
-        QByteArray message = QJsonDocument(jsonMessage).toJson(QJsonDocument::JsonFormat::Compact);
 
-        QNetworkRequest request(currentUrl);
-        request.setHeader(QNetworkRequest::KnownHeaders::UserAgentHeader, server()->userAgent());
-        request.setHeader(QNetworkRequest::KnownHeaders::ContentTypeHeader, "application/json");
-        request.setHeader(QNetworkRequest::KnownHeaders::ContentLengthHeader, message.size());
-        request.setTransferTimeout();
+    QByteArray InesonicRestHandler::encodePayload(const QByteArray& payload) {
+        // The envelope matches the compact output of QJsonDocument for an object holding the "data" and "hash"
+        // members.  Base64 output never requires escaping so we write it directly.
+        unsigned long payloadLength = static_cast<unsigned long>(payload.size());
+        unsigned long resultLength  = (
+              envelopeDataPrefixLength
+            + Base64::encodedLength(payloadLength)
+            + envelopeHashPrefixLength
+        );
+        QByteArray    result(static_cast<int>(resultLength), Qt::Uninitialized);
 
-        pendingReply = server()->post(request, message);
-        pendingReply->setParent(this);
+        char* destination = result.data();
+        std::memcpy(destination, envelopeDataPrefix, envelopeDataPrefixLength);
+        destination = Base64::encode(payload.constData(), payloadLength, destination + envelopeDataPrefixLength);
+        std::memcpy(destination, envelopeHashPrefix, envelopeHashPrefixLength);
 
-        connect(pendingReply, &QNetworkReply::finished, this, &InesonicRestHandler::responseReceived);
+        return result;
     }
 
 
-    void InesonicRestHandler::timestampUpdateFailed() {
-        if (pendingReply != nullptr) {
-            pendingReply->deleteLater();
-            pendingReply = nullptr;
+    QByteArray InesonicRestHandler::buildMessage(const QByteArray& encodedPayload, const QByteArray& hash) {
+        unsigned long encodedLength = static_cast<unsigned long>(encodedPayload.size());
+        unsigned long hashLength    = static_cast<unsigned long>(hash.size());
+        QByteArray    result(
+            static_cast<int>(encodedLength + Base64::encodedLength(hashLength) + envelopeSuffixLength),
+            Qt::Uninitialized
+        );
+
+        char* destination = result.data();
+        std::memcpy(destination, encodedPayload.constData(), encodedLength);
+        destination = Base64::encode(hash.constData(), hashLength, destination + encodedLength);
+        std::memcpy(destination, envelopeSuffix, envelopeSuffixLength);
+
+        return result;
+    }
+
+
+    QString InesonicRestHandler::messageContentType() const {
+        return QString("application/json");
+    }
+
+
+    void InesonicRestHandler::processReply(unsigned long long requestId, QNetworkReply* reply) {
+        QByteArray receivedData = reply->readAll();
+
+        QJsonParseError parseError;
+        QJsonDocument   jsonDocument = QJsonDocument::fromJson(receivedData, &parseError);
+        if (parseError.error == QJsonParseError::NoError) {
+            if (requestCallbacks.isEmpty()) {
+                processJsonResponse(requestId, jsonDocument);
+            } else {
+                QHash<unsigned long long, Callbacks>::iterator it = requestCallbacks.find(requestId);
+                if (it != requestCallbacks.end()) {
+                    ResponseCallback responseCallback = it.value().responseCallback;
+                    requestCallbacks.erase(it);
+
+                    if (responseCallback) {
+                        responseCallback(requestId, jsonDocument);
+                    }
+                } else {
+                    processJsonResponse(requestId, jsonDocument);
+                }
+            }
+        } else {
+            processFailure(requestId, QString("Response not JSON format"));
         }
+    }
+
+
+    void InesonicRestHandler::processFailure(unsigned long long requestId, const QString& errorString) {
+        if (requestCallbacks.isEmpty()) {
+            processRequestFailed(requestId, errorString);
+        } else {
+            QHash<unsigned long long, Callbacks>::iterator it = requestCallbacks.find(requestId);
+            if (it != requestCallbacks.end()) {
+                FailureCallback failureCallback = it.value().failureCallback;
+                requestCallbacks.erase(it);
+
+                if (failureCallback) {
+                    failureCallback(requestId, errorString);
+                } else {
+                    processRequestFailed(requestId, errorString);
+                }
+            } else {
+                processRequestFailed(requestId, errorString);
+            }
+        }
+    }
+
+
+    unsigned long long InesonicRestHandler::postPayload(
+            const QString&      endpoint,
+            const QByteArray&   payload,
+            const RequestSetup& setup
+        ) {
+        selectServer();
+        return startRequest(endpoint, QUrl(server()->schemeAndHost().toString() + endpoint), payload, setup);
+    }
+
+
+    void InesonicRestHandler::registerCallbacks(
+            unsigned long long      requestId,
+            const ResponseCallback& responseCallback,
+            const FailureCallback&  failureCallback
+        ) {
+        Callbacks callbacks;
+        callbacks.responseCallback = responseCallback;
+        callbacks.failureCallback  = failureCallback;
 
-        processRequestFailed(QString("Failed to sync with server."));
+        requestCallbacks.insert(requestId, callbacks);
     }
 }
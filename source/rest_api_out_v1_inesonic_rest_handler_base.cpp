@@ -35,14 +35,21 @@
 #include <QNetworkReply>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QUrl>
+#include <QSet>
+#include <QHash>
+#include <QList>
+#include <QElapsedTimer>
 
 #include <cstring>
+#include <algorithm>
 
 #include <crypto_aes_cbc_encryptor.h>
 #include <crypto_hmac.h>
 #include <crypto_helpers.h>
 
 #include "rest_api_out_v1_server.h"
+#include "rest_api_out_v1_base64.h"
 #include "rest_api_out_v1_inesonic_rest_handler_base.h"
 
 namespace RestApiOutV1 {
@@ -51,22 +58,73 @@ namespace RestApiOutV1 {
     static const unsigned                hmacDigestSize  = Crypto::Hmac::digestSize(hashAlgorithm);
     static const unsigned                timestampLength = 8;
 
-    const unsigned InesonicRestHandlerBase::secretLength = hmacBlockSize - timestampLength;
-    const unsigned InesonicRestHandlerBase::hashLength   = hmacDigestSize;
+    /**
+     * The maximum number of released requests sent at once when the server does not pace resumption.
+     */
+    static const unsigned defaultReleaseBatchSize = 16;
+
+    const unsigned  InesonicRestHandlerBase::secretLength      = hmacBlockSize - timestampLength;
+    const unsigned  InesonicRestHandlerBase::hashLength        = hmacDigestSize;
+    const long long InesonicRestHandlerBase::signingWindow     = 30000;
+    const char      InesonicRestHandlerBase::signatureHeader[] = "X-Inesonic-Hash";
+
+    InesonicRestHandlerBase::InesonicRestHandlerBase(
+            Server* server
+        ):Server::RestApi(
+            server
+        ),submissionServer(
+            server
+        ) {
+        currentSignatureMargin = signingWindow / 2;
+        currentHedgeDelay      = -1;
+        currentPriority        = Server::Priority::NORMAL;
+        nextRequestId          = 1;
+        releasePending         = false;
+
+        currentHeaderSignatureEnabled = false;
+    }
 
-    InesonicRestHandlerBase::InesonicRestHandlerBase(Server* server):Server::RestApi(server) {}
 
     InesonicRestHandlerBase::InesonicRestHandlerBase(
             const QByteArray& secret,
             Server*           server
         ):Server::RestApi(
             server
+        ),submissionServer(
+            server
         ) {
+        currentSignatureMargin = signingWindow / 2;
+        currentHedgeDelay      = -1;
+        currentPriority        = Server::Priority::NORMAL;
+        nextRequestId          = 1;
+        releasePending         = false;
+
+        currentHeaderSignatureEnabled = false;
+
         setSecret(secret);
     }
 
 
     InesonicRestHandlerBase::~InesonicRestHandlerBase() {
+        // Aborting a reply releases a slot on the server which dispatches the next scheduled request.  We cancel
+        // every scheduled copy first so the scheduler can not call back into this partially destroyed handler.
+        for (  QHash<unsigned long long, PendingRequest*>::const_iterator it  = pendingRequests.constBegin(),
+                                                                          end = pendingRequests.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            cancelScheduled(it.value());
+        }
+
+        for (  QHash<unsigned long long, PendingRequest*>::const_iterator it  = pendingRequests.constBegin(),
+                                                                          end = pendingRequests.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            abortReplies(it.value());
+            delete it.value();
+        }
+
         Crypto::scrub(currentSecret);
     }
 
@@ -77,31 +135,470 @@ namespace RestApiOutV1 {
         Crypto::scrub(currentSecret);
         currentSecret.resize(hmacBlockSize);
         memcpy(currentSecret.data(), newSecret.data(), secretLength);
+
+        secretRateKey          = Server::rateLimitKey(newSecret);
+        secretSigningKey.valid = false;
+    }
+
+
+    void InesonicRestHandlerBase::setIdempotent(const QString& endpoint, bool nowIdempotent) {
+        if (nowIdempotent) {
+            idempotentEndpoints.insert(endpoint);
+        } else {
+            idempotentEndpoints.remove(endpoint);
+        }
+    }
+
+
+    bool InesonicRestHandlerBase::isIdempotent(const QString& endpoint) const {
+        return idempotentEndpoints.contains(endpoint);
+    }
+
+
+    void InesonicRestHandlerBase::setHedgeDelay(long long newHedgeDelay) {
+        currentHedgeDelay = newHedgeDelay;
+    }
+
+
+    long long InesonicRestHandlerBase::hedgeDelay() const {
+        return currentHedgeDelay;
+    }
+
+
+    void InesonicRestHandlerBase::setPriority(Server::Priority newPriority) {
+        currentPriority = newPriority;
+    }
+
+
+    Server::Priority InesonicRestHandlerBase::priority() const {
+        return currentPriority;
+    }
+
+
+    void InesonicRestHandlerBase::setHeaderSignatureEnabled(bool nowEnabled) {
+        currentHeaderSignatureEnabled = nowEnabled;
+    }
+
+
+    void InesonicRestHandlerBase::setHeaderSignatureDisabled(bool nowDisabled) {
+        setHeaderSignatureEnabled(!nowDisabled);
+    }
+
+
+    bool InesonicRestHandlerBase::headerSignatureEnabled() const {
+        return currentHeaderSignatureEnabled;
+    }
+
+
+    bool InesonicRestHandlerBase::headerSignatureDisabled() const {
+        return !currentHeaderSignatureEnabled;
+    }
+
+
+    unsigned long InesonicRestHandlerBase::numberPendingRequests() const {
+        return static_cast<unsigned long>(pendingRequests.size());
     }
 
 
     QByteArray InesonicRestHandlerBase::calculateHash(const QByteArray& payload) {
+        return calculateHash(payload, server());
+    }
+
+
+    QByteArray InesonicRestHandlerBase::encodePayload(const QByteArray& payload) {
+        return payload;
+    }
+
+
+    void InesonicRestHandlerBase::attachRequestContext(QObject* handler) {
+        requestContext.setParent(handler);
+    }
+
+
+    void InesonicRestHandlerBase::submitTask(const Server::Task& task) {
+        submissionServer->submit(task);
+    }
+
+
+    unsigned long long InesonicRestHandlerBase::startRequest(
+            const QString&      endpoint,
+            const QUrl&         url,
+            const QByteArray&   payload,
+            const RequestSetup& setup
+        ) {
+        PendingRequest* request = new PendingRequest;
+
+        request->requestId        = nextRequestId++;
+        request->server           = server();
+        request->endpoint         = endpoint;
+        request->url              = url;
+        request->payload          = payload;
+        request->isEncoded        = false;
+        request->headerSignature  = currentHeaderSignatureEnabled;
+        request->retriesRemaining = 1;
+        request->signatureMargin  = signingWindow / 2;
+        request->reply            = nullptr;
+        request->hedgeReply       = nullptr;
+        request->hedgeSendTime    = 0;
+        request->attempt          = 0;
+        request->ticket           = 0;
+        request->hedgeTicket      = 0;
+
+        pendingRequests.insert(request->requestId, request);
+
+        if (setup) {
+            setup(request->requestId);
+        }
+
+        if (request->server->checkTimestamp(this)) {
+            sendRequest(request);
+        } else {
+            waitingRequests.append(request);
+        }
+
+        return request->requestId;
+    }
+
+
+    void InesonicRestHandlerBase::timestampUpdated() {
+        releasingRequests.append(takeReadyRequests());
+        if (!releasePending) {
+            releaseRequests();
+        }
+    }
+
+
+    void InesonicRestHandlerBase::timestampUpdateFailed() {
+        QList<PendingRequest*> failedRequests = takeReadyRequests();
+        for (  QList<PendingRequest*>::const_iterator it  = failedRequests.constBegin(),
+                                                      end = failedRequests.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            PendingRequest*    request   = *it;
+            unsigned long long requestId = request->requestId;
+
+            pendingRequests.remove(requestId);
+            delete request;
+
+            processFailure(requestId, QString("Failed to sync with server."));
+        }
+    }
+
+
+    QByteArray InesonicRestHandlerBase::calculateHash(const QByteArray& payload, Server* server) {
         QByteArray result;
 
-        unsigned long long currentTimestamp = QDateTime::currentSecsSinceEpoch();
-        long long          timeDelta        = server()->timeDelta();
-        unsigned long long hashSuffix       = (currentTimestamp + timeDelta) / 30;
+        unsigned long long currentTimestamp = QDateTime::currentMSecsSinceEpoch();
+        long long          timeDelta        = server->timeDeltaMilliseconds();
+        unsigned long long arrivalTimestamp = currentTimestamp + timeDelta + server->expectedTransitTime();
+        unsigned long long hashSuffix       = arrivalTimestamp / signingWindow;
+        long long          windowOffset     = static_cast<long long>(arrivalTimestamp % signingWindow);
+
+        currentSignatureMargin = std::min(windowOffset, signingWindow - windowOffset);
+        server->recordSignature();
 
+        // The HMAC key changes only when the signing window advances, so we prepare it once per window and only
+        // hash the payload here.
         if (!currentSecret.isEmpty()) {
-            std::uint64_t* rawSecret  = reinterpret_cast<std::uint64_t*>(currentSecret.data());
-            rawSecret[secretLength / 8] = hashSuffix;
+            if (!secretSigningKey.valid || secretSigningKey.window != hashSuffix) {
+                std::uint64_t* rawSecret  = reinterpret_cast<std::uint64_t*>(currentSecret.data());
+                rawSecret[secretLength / 8] = hashSuffix;
+
+                secretSigningKey.hmac.setKey(currentSecret);
+                secretSigningKey.window = hashSuffix;
+                secretSigningKey.valid  = true;
+            }
 
-            Crypto::Hmac hmac(currentSecret, payload, hashAlgorithm);
-            result = hmac.digest();
+            result = secretSigningKey.hmac.digest(payload);
         } else {
-            QByteArray     fullSecret = server()->currentDefaultSecret;
-            std::uint64_t* rawSecret  = reinterpret_cast<std::uint64_t*>(fullSecret.data());
-            rawSecret[secretLength / 8] = hashSuffix;
+            SigningKey& signingKey = defaultSigningKeys[server];
+            if (!signingKey.valid                                            ||
+                signingKey.window != hashSuffix                              ||
+                signingKey.generation != server->defaultSecretGeneration    ) {
+                // The key is built on the stack so that the server's secret is not copied to the heap.
+                std::uint64_t fullSecret[8];
+                Q_ASSERT(sizeof(fullSecret) == hmacBlockSize);
+
+                memcpy(fullSecret, server->currentDefaultSecret.constData(), hmacBlockSize);
+                fullSecret[secretLength / 8] = hashSuffix;
+
+                signingKey.hmac.setKey(reinterpret_cast<const char*>(fullSecret), hmacBlockSize);
+                signingKey.window     = hashSuffix;
+                signingKey.generation = server->defaultSecretGeneration;
+                signingKey.valid      = true;
+
+                volatile std::uint64_t* scrubbedSecret = fullSecret;
+                for (unsigned i=0 ; i<8 ; ++i) {
+                    scrubbedSecret[i] = 0;
+                }
+            }
+
+            result = signingKey.hmac.digest(payload);
+        }
+
+        return result;
+    }
+
+
+    void InesonicRestHandlerBase::sendRequest(PendingRequest* request) {
+        abortReplies(request);
+
+        unsigned long long ticket = scheduleRequest(request, false);
+        if (ticket != Server::rejectedTicket) {
+            request->ticket = ticket;
+        } else {
+            // The failure is reported from the event loop so that callers always receive the request ID first.
+            unsigned long long requestId = request->requestId;
+            QTimer::singleShot(0, &requestContext, [this, requestId]() {
+                PendingRequest* request = pendingRequests.take(requestId);
+                if (request != nullptr) {
+                    waitingRequests.removeAll(request);
+                    abortReplies(request);
+                    delete request;
+
+                    processFailure(requestId, QString("Request rejected, server overloaded."));
+                }
+            });
+        }
+    }
+
+
+    unsigned long long InesonicRestHandlerBase::scheduleRequest(PendingRequest* request, bool isHedge) {
+        unsigned long long requestId = request->requestId;
+        return request->server->schedule(
+            currentPriority,
+            this,
+            [this, requestId, isHedge]() {
+                return issueRequest(requestId, isHedge);
+            },
+            request->endpoint,
+            secretRateKey
+        );
+    }
 
-            Crypto::Hmac hmac(fullSecret, payload, hashAlgorithm);
-            result = hmac.digest();
+
+    QNetworkReply* InesonicRestHandlerBase::issueRequest(unsigned long long requestId, bool isHedge) {
+        QNetworkReply*  result  = nullptr;
+        PendingRequest* request = pendingRequests.value(requestId, nullptr);
+
+        if (request != nullptr) {
+            if (isHedge) {
+                request->hedgeTicket = 0;
+                if (request->reply != nullptr && request->hedgeReply == nullptr) {
+                    request->hedgeSendTime = request->timer.elapsed();
+                    request->hedgeReply    = transmitRequest(request);
+                    result                 = request->hedgeReply;
+                }
+            } else {
+                request->ticket = 0;
+                request->timer.start();
+                request->reply = transmitRequest(request);
+                result         = request->reply;
+
+                unsigned attempt = ++request->attempt;
+
+                if (idempotentEndpoints.contains(request->endpoint)) {
+                    long long delay = (
+                          currentHedgeDelay >= 0
+                        ? currentHedgeDelay
+                        : request->server->latencyPercentile(95)
+                    );
+
+                    if (delay >= 0) {
+                        QTimer::singleShot(
+                            static_cast<int>(std::min(delay, 0x7FFFFFFFLL)),
+                            &requestContext,
+                            [this, requestId, attempt]() {
+                                sendHedge(requestId, attempt);
+                            }
+                        );
+                    }
+                }
+            }
         }
 
         return result;
     }
+
+
+    QNetworkReply* InesonicRestHandlerBase::transmitRequest(PendingRequest* request) {
+        QByteArray hash = calculateHash(request->payload, request->server);
+        QByteArray message;
+
+        if (request->headerSignature) {
+            message = request->payload;
+        } else {
+            if (!request->isEncoded) {
+                request->encodedPayload = encodePayload(request->payload);
+                request->isEncoded      = true;
+            }
+
+            message = buildMessage(request->encodedPayload, hash);
+        }
+
+        request->signatureMargin = currentSignatureMargin;
+
+        QNetworkRequest networkRequest(request->url);
+        networkRequest.setHeader(QNetworkRequest::KnownHeaders::UserAgentHeader, request->server->userAgent());
+        networkRequest.setHeader(QNetworkRequest::KnownHeaders::ContentTypeHeader, messageContentType());
+        networkRequest.setHeader(QNetworkRequest::KnownHeaders::ContentLengthHeader, message.size());
+        networkRequest.setTransferTimeout();
+
+        if (request->headerSignature) {
+            networkRequest.setRawHeader(signatureHeader, Base64::encode(hash));
+        }
+
+        QNetworkReply* reply = request->server->post(networkRequest, message);
+        reply->setParent(&requestContext);
+
+        requestsByReply.insert(reply, request);
+        QObject::connect(
+            reply,
+            &QNetworkReply::finished,
+            &requestContext,
+            [this, reply]() {
+                replyFinished(reply);
+            }
+        );
+
+        return reply;
+    }
+
+
+    void InesonicRestHandlerBase::sendHedge(unsigned long long requestId, unsigned attempt) {
+        PendingRequest* request = pendingRequests.value(requestId, nullptr);
+        if (request != nullptr && request->attempt == attempt && request->reply != nullptr &&
+            request->hedgeReply == nullptr && request->hedgeTicket == 0                          ) {
+            unsigned long long ticket = scheduleRequest(request, true);
+            if (ticket != Server::rejectedTicket) {
+                request->hedgeTicket = ticket;
+            }
+        }
+    }
+
+
+    void InesonicRestHandlerBase::replyFinished(QNetworkReply* reply) {
+        PendingRequest* request = requestsByReply.take(reply);
+        if (request != nullptr) {
+            bool                        isHedge      = (reply == request->hedgeReply);
+            QNetworkReply*              otherReply   = isHedge ? request->reply : request->hedgeReply;
+            QNetworkReply::NetworkError networkError = reply->error();
+
+            request->server->recordResponse(reply, request->timer.elapsed() - (isHedge ? request->hedgeSendTime : 0));
+            reply->deleteLater();
+
+            if (isHedge) {
+                request->hedgeReply = nullptr;
+            } else {
+                request->reply = nullptr;
+            }
+
+            if (otherReply == nullptr                                                     ||
+                networkError == QNetworkReply::NetworkError::NoError                      ||
+                networkError == QNetworkReply::NetworkError::AuthenticationRequiredError     ) {
+                abortReplies(request);
+
+                if (networkError == QNetworkReply::NetworkError::AuthenticationRequiredError &&
+                    request->retriesRemaining > 0                                               ) {
+                    request->server->recordAuthenticationFailure(request->signatureMargin);
+
+                    --request->retriesRemaining;
+                    waitingRequests.append(request);
+                    request->server->updateTimeDelta(this);
+                } else {
+                    unsigned long long requestId = request->requestId;
+
+                    pendingRequests.remove(requestId);
+                    delete request;
+
+                    if (networkError == QNetworkReply::NetworkError::NoError) {
+                        processReply(requestId, reply);
+                    } else {
+                        processFailure(requestId, reply->errorString());
+                    }
+                }
+            }
+
+            // If the other copy of a hedged request is still outstanding after a failure, we wait for it as it may
+            // yet succeed.
+        }
+    }
+
+
+    void InesonicRestHandlerBase::cancelScheduled(PendingRequest* request) {
+        if (!request->server.isNull()) {
+            if (request->ticket != 0) {
+                request->server->cancelScheduled(request->ticket);
+            }
+
+            if (request->hedgeTicket != 0) {
+                request->server->cancelScheduled(request->hedgeTicket);
+            }
+        }
+
+        request->ticket      = 0;
+        request->hedgeTicket = 0;
+    }
+
+
+    void InesonicRestHandlerBase::abortReplies(PendingRequest* request) {
+        cancelScheduled(request);
+
+        if (request->reply != nullptr) {
+            requestsByReply.remove(request->reply);
+            request->reply->disconnect(&requestContext);
+            request->reply->abort();
+            request->reply->deleteLater();
+            request->reply = nullptr;
+        }
+
+        if (request->hedgeReply != nullptr) {
+            requestsByReply.remove(request->hedgeReply);
+            request->hedgeReply->disconnect(&requestContext);
+            request->hedgeReply->abort();
+            request->hedgeReply->deleteLater();
+            request->hedgeReply = nullptr;
+        }
+    }
+
+
+    QList<InesonicRestHandlerBase::PendingRequest*> InesonicRestHandlerBase::takeReadyRequests() {
+        QList<PendingRequest*> readyRequests;
+
+        QList<PendingRequest*>::iterator it = waitingRequests.begin();
+        while (it != waitingRequests.end()) {
+            if (!(*it)->server->timestampUpdatePending.load(std::memory_order_acquire)) {
+                readyRequests.append(*it);
+                it = waitingRequests.erase(it);
+            } else {
+                ++it;
+            }
+        }
+
+        return readyRequests;
+    }
+
+
+    void InesonicRestHandlerBase::releaseRequests() {
+        unsigned batchSize = server()->resumeBatchSize();
+        if (batchSize == 0) {
+            batchSize = defaultReleaseBatchSize;
+        }
+
+        releasePending = false;
+
+        unsigned numberReleased = 0;
+        while (numberReleased < batchSize && !releasingRequests.isEmpty()) {
+            sendRequest(releasingRequests.takeFirst());
+            ++numberReleased;
+        }
+
+        if (!releasingRequests.isEmpty()) {
+            releasePending = true;
+            QTimer::singleShot(static_cast<int>(server()->resumeInterval()), &requestContext, [this]() {
+                releaseRequests();
+            });
+        }
+    }
 }
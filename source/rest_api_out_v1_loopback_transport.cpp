@@ -0,0 +1,110 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref RestApiOutV1::LoopbackTransport class.
+***********************************************************************************************************************/
+
+#include <QObject>
+#include <QMetaObject>
+#include <QPointer>
+#include <QString>
+#include <QByteArray>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+
+#include "rest_api_out_v1_transport.h"
+#include "rest_api_out_v1_pipelined_network_reply.h"
+#include "rest_api_out_v1_loopback_transport.h"
+
+namespace RestApiOutV1 {
+    LoopbackTransport::Receiver::~Receiver() {}
+
+
+    LoopbackTransport::LoopbackTransport(
+            LoopbackTransport::Receiver* receiver,
+            QObject*                     parent
+        ):Transport(
+            parent
+        ),currentReceiver(
+            receiver
+        ) {}
+
+
+    LoopbackTransport::~LoopbackTransport() {}
+
+
+    void LoopbackTransport::setReceiver(LoopbackTransport::Receiver* newReceiver) {
+        currentReceiver = newReceiver;
+    }
+
+
+    LoopbackTransport::Receiver* LoopbackTransport::receiver() const {
+        return currentReceiver;
+    }
+
+
+    QNetworkReply* LoopbackTransport::post(const QNetworkRequest& request, const QByteArray& payload) {
+        PipelinedNetworkReply*      reply     = new PipelinedNetworkReply(request);
+        QPointer<LoopbackTransport> transport = this;
+
+        QMetaObject::invokeMethod(
+            reply,
+            [transport, reply, request, payload]() {
+                if (!transport.isNull()) {
+                    transport->deliver(reply, request, payload);
+                } else if (!reply->isFinished()) {
+                    reply->setFailed(
+                        QNetworkReply::NetworkError::OperationCanceledError,
+                        QString("Operation canceled")
+                    );
+                }
+            },
+            Qt::ConnectionType::QueuedConnection
+        );
+
+        return reply;
+    }
+
+
+    void LoopbackTransport::deliver(
+            PipelinedNetworkReply* reply,
+            const QNetworkRequest& request,
+            const QByteArray&      payload
+        ) {
+        if (!reply->isFinished()) {
+            if (currentReceiver != nullptr) {
+                Receiver::Response response = currentReceiver->processRequest(request, payload);
+
+                PipelinedNetworkReply::HeaderList headers;
+                if (!response.contentType.isEmpty()) {
+                    headers.append(qMakePair(QByteArray("Content-Type"), response.contentType));
+                }
+
+                headers.append(qMakePair(QByteArray("Content-Length"), QByteArray::number(response.body.size())));
+
+                reply->setResponse(response.statusCode, QByteArray(), headers, response.body);
+            } else {
+                reply->setFailed(
+                    QNetworkReply::NetworkError::ConnectionRefusedError,
+                    QString("No loopback receiver")
+                );
+            }
+        }
+    }
+}
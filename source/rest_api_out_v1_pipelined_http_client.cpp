@@ -0,0 +1,874 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref RestApiOutV1::PipelinedHttpClient class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QObject>
+#include <QMetaObject>
+#include <QString>
+#include <QByteArray>
+#include <QUrl>
+#include <QList>
+#include <QHash>
+#include <QPointer>
+#include <QTimer>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QIODevice>
+#include <QAbstractSocket>
+#include <QTcpSocket>
+#include <QLocalSocket>
+
+#ifndef QT_NO_SSL
+    #include <QSslSocket>
+#endif
+
+#include <algorithm>
+
+#include "rest_api_out_v1_pipelined_network_reply.h"
+#include "rest_api_out_v1_pipelined_http_client.h"
+
+namespace RestApiOutV1 {
+    /**
+     * Maximum number of serialized header blocks to cache.
+     */
+    static const int maximumHeaderBlockCacheSize = 64;
+
+    /**
+     * Maximum length of a status line, header line, or chunk size line.
+     */
+    static const int maximumLineLength = 16384;
+
+    /**
+     * Method that translates a socket error to a network reply error.
+     *
+     * \param[in] socketError The socket error.
+     *
+     * \return Returns the equivalent network reply error.
+     */
+    static QNetworkReply::NetworkError toNetworkError(QAbstractSocket::SocketError socketError) {
+        QNetworkReply::NetworkError result;
+
+        switch (socketError) {
+            case QAbstractSocket::SocketError::ConnectionRefusedError: {
+                result = QNetworkReply::NetworkError::ConnectionRefusedError;
+                break;
+            }
+
+            case QAbstractSocket::SocketError::RemoteHostClosedError:
+            case QAbstractSocket::SocketError::UnknownSocketError: {
+                result = QNetworkReply::NetworkError::RemoteHostClosedError;
+                break;
+            }
+
+            case QAbstractSocket::SocketError::HostNotFoundError: {
+                result = QNetworkReply::NetworkError::HostNotFoundError;
+                break;
+            }
+
+            case QAbstractSocket::SocketError::SocketTimeoutError: {
+                result = QNetworkReply::NetworkError::TimeoutError;
+                break;
+            }
+
+            case QAbstractSocket::SocketError::SslHandshakeFailedError: {
+                result = QNetworkReply::NetworkError::SslHandshakeFailedError;
+                break;
+            }
+
+            default: {
+                result = QNetworkReply::NetworkError::UnknownNetworkError;
+                break;
+            }
+        }
+
+        return result;
+    }
+
+    /**
+     * Method that translates a local socket error to a network reply error.
+     *
+     * \param[in] socketError The local socket error.
+     *
+     * \return Returns the equivalent network reply error.
+     */
+    static QNetworkReply::NetworkError toNetworkError(QLocalSocket::LocalSocketError socketError) {
+        QNetworkReply::NetworkError result;
+
+        switch (socketError) {
+            case QLocalSocket::LocalSocketError::ConnectionRefusedError: {
+                result = QNetworkReply::NetworkError::ConnectionRefusedError;
+                break;
+            }
+
+            case QLocalSocket::LocalSocketError::PeerClosedError:
+            case QLocalSocket::LocalSocketError::UnknownSocketError: {
+                result = QNetworkReply::NetworkError::RemoteHostClosedError;
+                break;
+            }
+
+            case QLocalSocket::LocalSocketError::ServerNotFoundError: {
+                result = QNetworkReply::NetworkError::HostNotFoundError;
+                break;
+            }
+
+            case QLocalSocket::LocalSocketError::SocketTimeoutError: {
+                result = QNetworkReply::NetworkError::TimeoutError;
+                break;
+            }
+
+            default: {
+                result = QNetworkReply::NetworkError::UnknownNetworkError;
+                break;
+            }
+        }
+
+        return result;
+    }
+
+    const unsigned PipelinedHttpClient::defaultNumberConnections    = 2;
+    const unsigned PipelinedHttpClient::defaultMaximumPipelineDepth = 16;
+
+    PipelinedHttpClient::PipelinedHttpClient(
+            const QUrl& schemeAndHost,
+            QObject*    parent
+        ):PipelinedHttpClient(
+            QString(),
+            schemeAndHost,
+            parent
+        ) {}
+
+
+    PipelinedHttpClient::PipelinedHttpClient(
+            const QString& localServerName,
+            const QUrl&    schemeAndHost,
+            QObject*       parent
+        ):Transport(
+            parent
+        ),currentLocalServerName(
+            localServerName
+        ),currentSchemeAndHost(
+            schemeAndHost
+        ) {
+        currentNumberConnections    = defaultNumberConnections;
+        currentMaximumPipelineDepth = defaultMaximumPipelineDepth;
+        connectionAttemptFailed     = false;
+
+        bool       isHttps     = (currentSchemeAndHost.scheme() == QString("https"));
+        int        defaultPort = isHttps ? 443 : 80;
+        QByteArray host        = currentSchemeAndHost.host(QUrl::ComponentFormattingOption::FullyEncoded).toLatin1();
+
+        if (host.contains(':')) {
+            host = "[" + host + "]";
+        }
+
+        int port = currentSchemeAndHost.port(defaultPort);
+        if (port != defaultPort) {
+            host += ":" + QByteArray::number(port);
+        }
+
+        fixedHeaders = "Host: " + host + "\r\nConnection: keep-alive\r\nAccept-Encoding: identity\r\n";
+    }
+
+
+    PipelinedHttpClient::~PipelinedHttpClient() {
+        while (!connections.isEmpty()) {
+            closeConnection(
+                connections.first(),
+                QNetworkReply::NetworkError::OperationCanceledError,
+                QString("Operation canceled")
+            );
+        }
+
+        QList<OutgoingRequest> canceledRequests;
+        canceledRequests.swap(outgoingRequests);
+
+        for (  QList<OutgoingRequest>::const_iterator it  = canceledRequests.constBegin(),
+                                                      end = canceledRequests.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            if (!it->reply.isNull() && !it->reply->isFinished()) {
+                it->reply->setFailed(
+                    QNetworkReply::NetworkError::OperationCanceledError,
+                    QString("Operation canceled")
+                );
+            }
+        }
+    }
+
+
+    void PipelinedHttpClient::setNumberConnections(unsigned newNumberConnections) {
+        currentNumberConnections = std::max(newNumberConnections, 1U);
+    }
+
+
+    unsigned PipelinedHttpClient::numberConnections() const {
+        return currentNumberConnections;
+    }
+
+
+    void PipelinedHttpClient::setMaximumPipelineDepth(unsigned newMaximumPipelineDepth) {
+        currentMaximumPipelineDepth = std::max(newMaximumPipelineDepth, 1U);
+    }
+
+
+    unsigned PipelinedHttpClient::maximumPipelineDepth() const {
+        return currentMaximumPipelineDepth;
+    }
+
+
+    QNetworkReply* PipelinedHttpClient::post(const QNetworkRequest& request, const QByteArray& payload) {
+        PipelinedNetworkReply* reply = new PipelinedNetworkReply(request);
+
+        QUrl       url    = request.url();
+        QByteArray target = url.path(QUrl::ComponentFormattingOption::FullyEncoded).toLatin1();
+        if (target.isEmpty()) {
+            target = "/";
+        }
+
+        if (url.hasQuery()) {
+            target += "?" + url.query(QUrl::ComponentFormattingOption::FullyEncoded).toLatin1();
+        }
+
+        QByteArray headers       = headerBlock(request);
+        QByteArray contentLength = QByteArray::number(payload.size());
+
+        OutgoingRequest outgoingRequest;
+        outgoingRequest.reply = reply;
+        outgoingRequest.data.reserve(
+            target.size() + fixedHeaders.size() + headers.size() + contentLength.size() + payload.size() + 48
+        );
+
+        outgoingRequest.data.append("POST ");
+        outgoingRequest.data.append(target);
+        outgoingRequest.data.append(" HTTP/1.1\r\n");
+        outgoingRequest.data.append(fixedHeaders);
+        outgoingRequest.data.append(headers);
+        outgoingRequest.data.append("Content-Length: ");
+        outgoingRequest.data.append(contentLength);
+        outgoingRequest.data.append("\r\n\r\n");
+        outgoingRequest.data.append(payload);
+
+        int transferTimeout = request.transferTimeout();
+        if (transferTimeout > 0) {
+            // The timer belongs to the reply and the connection to this client so neither can outlive the other.
+            QTimer* timer = new QTimer(reply);
+            timer->setSingleShot(true);
+            connect(timer, &QTimer::timeout, this, [this, reply]() {
+                replyTimedOut(reply);
+            });
+
+            timer->start(transferTimeout);
+        }
+
+        outgoingRequests.append(outgoingRequest);
+        dispatch();
+
+        return reply;
+    }
+
+
+    void PipelinedHttpClient::dispatch() {
+        bool connectionPending = false;
+        for (  QList<Connection*>::const_iterator it  = connections.constBegin(),
+                                                  end = connections.constEnd()
+             ; it != end && !connectionPending
+             ; ++it
+            ) {
+            connectionPending = !(*it)->isConnected;
+        }
+
+        bool openNewConnection = false;
+        bool canDispatch       = true;
+        while (canDispatch && !outgoingRequests.isEmpty()) {
+            const OutgoingRequest& outgoingRequest = outgoingRequests.first();
+            if (outgoingRequest.reply.isNull() || outgoingRequest.reply->isFinished()) {
+                outgoingRequests.removeFirst();
+            } else {
+                Connection* bestConnection = nullptr;
+                for (  QList<Connection*>::const_iterator it  = connections.constBegin(),
+                                                          end = connections.constEnd()
+                     ; it != end
+                     ; ++it
+                    ) {
+                    Connection* connection = *it;
+                    if (connection->isConnected                                                             &&
+                        static_cast<unsigned>(connection->outstandingReplies.size()) < currentMaximumPipelineDepth &&
+                        (bestConnection == nullptr                                                ||
+                         connection->outstandingReplies.size() < bestConnection->outstandingReplies.size()   )    ) {
+                        bestConnection = connection;
+                    }
+                }
+
+                if (!connectionPending                                                      &&
+                    static_cast<unsigned>(connections.size()) < currentNumberConnections    &&
+                    (connections.isEmpty() || !connectionAttemptFailed)                      &&
+                    (bestConnection == nullptr || !bestConnection->outstandingReplies.isEmpty())) {
+                    openNewConnection = true;
+                    connectionPending = true;
+                }
+
+                if (bestConnection != nullptr) {
+                    bestConnection->socket->write(outgoingRequest.data);
+                    bestConnection->outstandingReplies.append(outgoingRequest.reply);
+                    outgoingRequests.removeFirst();
+                } else {
+                    canDispatch = false;
+                }
+            }
+        }
+
+        if (openNewConnection) {
+            // Opened last as a connection attempt can fail immediately and re-enter this class.
+            openConnection();
+        }
+    }
+
+
+    void PipelinedHttpClient::openConnection() {
+        Connection* connection = new Connection;
+
+        connection->isConnected        = false;
+        connection->parserState        = ParserState::STATUS_LINE;
+        connection->statusCode         = 0;
+        connection->remainingBytes     = 0;
+        connection->closeAfterResponse = false;
+
+        connections.append(connection);
+
+        if (!currentLocalServerName.isEmpty()) {
+            QLocalSocket* socket = new QLocalSocket(this);
+
+            connection->socket        = socket;
+            connection->networkSocket = nullptr;
+            connection->localSocket   = socket;
+
+            connect(socket, &QLocalSocket::connected, this, [this, connection]() {
+                connectionEstablished(connection);
+            });
+
+            connect(socket, &QLocalSocket::readyRead, this, [this, connection]() {
+                dataReceived(connection);
+            });
+
+            connect(socket, &QLocalSocket::disconnected, this, [this, connection]() {
+                connectionLost(connection);
+            });
+
+            connect(socket, &QLocalSocket::errorOccurred, this, [this, connection]() {
+                connectionLost(connection);
+            });
+
+            // Local sockets can report a failure to connect immediately so we start the connection from the event loop
+            // to avoid finishing replies before post returns.
+            QString serverName = currentLocalServerName;
+            QMetaObject::invokeMethod(
+                socket,
+                [socket, serverName]() {
+                    socket->connectToServer(serverName);
+                },
+                Qt::ConnectionType::QueuedConnection
+            );
+        } else {
+            QAbstractSocket* socket;
+            bool             isHttps = (currentSchemeAndHost.scheme() == QString("https"));
+
+            #ifndef QT_NO_SSL
+                if (isHttps) {
+                    QSslSocket* sslSocket = new QSslSocket(this);
+                    connect(sslSocket, &QSslSocket::encrypted, this, [this, connection]() {
+                        connectionEstablished(connection);
+                    });
+
+                    socket = sslSocket;
+                } else {
+                    socket = new QTcpSocket(this);
+                    connect(socket, &QAbstractSocket::connected, this, [this, connection]() {
+                        connectionEstablished(connection);
+                    });
+                }
+            #else
+                socket = new QTcpSocket(this);
+                connect(socket, &QAbstractSocket::connected, this, [this, connection]() {
+                    connectionEstablished(connection);
+                });
+            #endif
+
+            connection->socket        = socket;
+            connection->networkSocket = socket;
+            connection->localSocket   = nullptr;
+
+            connect(socket, &QAbstractSocket::readyRead, this, [this, connection]() {
+                dataReceived(connection);
+            });
+
+            connect(socket, &QAbstractSocket::disconnected, this, [this, connection]() {
+                connectionLost(connection);
+            });
+
+            connect(socket, &QAbstractSocket::errorOccurred, this, [this, connection]() {
+                connectionLost(connection);
+            });
+
+            // As with local sockets, we start the connection from the event loop so an immediate failure can't
+            // re-enter this class from within post.
+            QString host = currentSchemeAndHost.host();
+            if (isHttps) {
+                #ifndef QT_NO_SSL
+                    quint16 port = static_cast<quint16>(currentSchemeAndHost.port(443));
+                    QMetaObject::invokeMethod(
+                        socket,
+                        [socket, host, port]() {
+                            static_cast<QSslSocket*>(socket)->connectToHostEncrypted(host, port);
+                        },
+                        Qt::ConnectionType::QueuedConnection
+                    );
+                #else
+                    QMetaObject::invokeMethod(
+                        socket,
+                        [this, connection]() {
+                            connectionLost(connection);
+                        },
+                        Qt::ConnectionType::QueuedConnection
+                    );
+                #endif
+            } else {
+                quint16 port = static_cast<quint16>(currentSchemeAndHost.port(80));
+                QMetaObject::invokeMethod(
+                    socket,
+                    [socket, host, port]() {
+                        socket->connectToHost(host, port);
+                    },
+                    Qt::ConnectionType::QueuedConnection
+                );
+            }
+        }
+    }
+
+
+    void PipelinedHttpClient::connectionEstablished(Connection* connection) {
+        connection->isConnected = true;
+        connectionAttemptFailed = false;
+
+        if (connection->networkSocket != nullptr) {
+            connection->networkSocket->setSocketOption(QAbstractSocket::SocketOption::LowDelayOption, 1);
+        }
+
+        dispatch();
+    }
+
+
+    void PipelinedHttpClient::dataReceived(Connection* connection) {
+        connection->receiveBuffer.append(connection->socket->readAll());
+
+        if (!parseResponses(connection)) {
+            closeConnection(
+                connection,
+                QNetworkReply::NetworkError::ProtocolFailure,
+                QString("Malformed HTTP response")
+            );
+        } else if (connection->closeAfterResponse && connection->parserState == ParserState::STATUS_LINE) {
+            closeConnection(
+                connection,
+                QNetworkReply::NetworkError::RemoteHostClosedError,
+                QString("Connection closed by server")
+            );
+        }
+
+        dispatch();
+    }
+
+
+    void PipelinedHttpClient::connectionLost(Connection* connection) {
+        if (connections.contains(connection)) {
+            bool wasConnected = connection->isConnected;
+
+            QNetworkReply::NetworkError networkError;
+            if (connection->networkSocket != nullptr) {
+                networkError = toNetworkError(connection->networkSocket->error());
+            } else {
+                networkError = toNetworkError(connection->localSocket->error());
+            }
+
+            QString errorString;
+            if (networkError != QNetworkReply::NetworkError::RemoteHostClosedError) {
+                errorString = connection->socket->errorString();
+            } else {
+                errorString = QString("Connection closed by server");
+            }
+
+            if (!wasConnected) {
+                connectionAttemptFailed = true;
+            }
+
+            // Mark the connection as unusable before any replies finish so that requests issued from the finished
+            // signal are not sent on it.
+            connection->isConnected = false;
+
+            if (connection->parserState == ParserState::BODY_UNTIL_CLOSE) {
+                connection->body.append(connection->receiveBuffer);
+                connection->body.append(connection->socket->readAll());
+                connection->receiveBuffer.clear();
+
+                completeResponse(connection);
+            }
+
+            closeConnection(connection, networkError, errorString);
+
+            bool anyConnected = false;
+            for (  QList<Connection*>::const_iterator it  = connections.constBegin(),
+                                                      end = connections.constEnd()
+                 ; it != end && !anyConnected
+                 ; ++it
+                ) {
+                anyConnected = (*it)->isConnected;
+            }
+
+            if (!wasConnected && !anyConnected) {
+                // We could not reach the host so we fail the queued requests rather than retrying indefinitely.
+                QList<OutgoingRequest> failedRequests;
+                failedRequests.swap(outgoingRequests);
+
+                for (  QList<OutgoingRequest>::const_iterator it  = failedRequests.constBegin(),
+                                                              end = failedRequests.constEnd()
+                     ; it != end
+                     ; ++it
+                    ) {
+                    if (!it->reply.isNull() && !it->reply->isFinished()) {
+                        it->reply->setFailed(networkError, errorString);
+                    }
+                }
+            } else if (wasConnected) {
+                dispatch();
+            }
+        }
+    }
+
+
+    void PipelinedHttpClient::replyTimedOut(PipelinedNetworkReply* reply) {
+        if (!reply->isFinished()) {
+            QNetworkReply::NetworkError networkError = QNetworkReply::NetworkError::TimeoutError;
+            QString                     errorString  = QString("Operation timed out");
+
+            Connection* timedOutConnection = nullptr;
+            for (  QList<Connection*>::const_iterator it  = connections.constBegin(),
+                                                      end = connections.constEnd()
+                 ; it != end && timedOutConnection == nullptr
+                 ; ++it
+                ) {
+                if ((*it)->outstandingReplies.contains(reply)) {
+                    timedOutConnection = *it;
+                }
+            }
+
+            if (timedOutConnection != nullptr) {
+                // Replies queued behind the timed out reply on this connection fail with it.
+                closeConnection(timedOutConnection, networkError, errorString);
+            } else {
+                // The request is still queued.  The dispatcher drops finished replies.
+                reply->setFailed(networkError, errorString);
+            }
+
+            dispatch();
+        }
+    }
+
+
+    bool PipelinedHttpClient::parseResponses(Connection* connection) {
+        bool        success = true;
+        bool        more    = true;
+        int         offset  = 0;
+        QByteArray& buffer  = connection->receiveBuffer;
+
+        while (success && more) {
+            switch (connection->parserState) {
+                case ParserState::STATUS_LINE:
+                case ParserState::HEADERS:
+                case ParserState::CHUNK_SIZE:
+                case ParserState::CHUNK_TRAILER: {
+                    int lineEnd = buffer.indexOf("\r\n", offset);
+                    if (lineEnd < 0) {
+                        success = (buffer.size() - offset) <= maximumLineLength;
+                        more    = false;
+                    } else {
+                        QByteArray line = buffer.mid(offset, lineEnd - offset);
+                        offset = lineEnd + 2;
+
+                        if (connection->parserState == ParserState::STATUS_LINE) {
+                            if (!line.isEmpty()) {
+                                int firstSpace = line.indexOf(' ');
+                                if (!line.startsWith("HTTP/1.")                 ||
+                                    firstSpace < 0                              ||
+                                    connection->outstandingReplies.isEmpty()       ) {
+                                    success = false;
+                                } else {
+                                    int secondSpace = line.indexOf(' ', firstSpace + 1);
+                                    connection->statusCode = line.mid(
+                                        firstSpace + 1,
+                                        secondSpace < 0 ? -1 : secondSpace - firstSpace - 1
+                                    ).toInt(&success);
+
+                                    connection->reasonPhrase       = secondSpace < 0
+                                                                     ? QByteArray()
+                                                                     : line.mid(secondSpace + 1);
+                                    connection->closeAfterResponse = line.startsWith("HTTP/1.0");
+                                    connection->headers.clear();
+                                    connection->body.clear();
+                                    connection->parserState = ParserState::HEADERS;
+                                }
+                            }
+                        } else if (connection->parserState == ParserState::HEADERS) {
+                            if (line.isEmpty()) {
+                                success = startBody(connection);
+                            } else {
+                                int colon = line.indexOf(':');
+                                if (colon <= 0) {
+                                    success = false;
+                                } else {
+                                    connection->headers.append(
+                                        qMakePair(line.left(colon).trimmed(), line.mid(colon + 1).trimmed())
+                                    );
+                                }
+                            }
+                        } else if (connection->parserState == ParserState::CHUNK_SIZE) {
+                            int extension = line.indexOf(';');
+                            connection->remainingBytes = line.left(extension).trimmed().toLongLong(&success, 16);
+                            if (success) {
+                                if (connection->remainingBytes < 0) {
+                                    success = false;
+                                } else if (connection->remainingBytes == 0) {
+                                    connection->parserState = ParserState::CHUNK_TRAILER;
+                                } else {
+                                    connection->parserState = ParserState::CHUNK_DATA;
+                                }
+                            }
+                        } else /* ParserState::CHUNK_TRAILER */ {
+                            if (line.isEmpty()) {
+                                completeResponse(connection);
+                                more = !connection->closeAfterResponse;
+                            }
+                        }
+                    }
+
+                    break;
+                }
+
+                case ParserState::BODY:
+                case ParserState::CHUNK_DATA: {
+                    long long available = std::min(
+                        connection->remainingBytes,
+                        static_cast<long long>(buffer.size() - offset)
+                    );
+
+                    connection->body.append(buffer.constData() + offset, static_cast<int>(available));
+                    offset                     += static_cast<int>(available);
+                    connection->remainingBytes -= available;
+
+                    if (connection->remainingBytes > 0) {
+                        more = false;
+                    } else if (connection->parserState == ParserState::CHUNK_DATA) {
+                        connection->parserState = ParserState::CHUNK_DATA_END;
+                    } else {
+                        completeResponse(connection);
+                        more = !connection->closeAfterResponse;
+                    }
+
+                    break;
+                }
+
+                case ParserState::CHUNK_DATA_END: {
+                    if (buffer.size() - offset < 2) {
+                        more = false;
+                    } else if (buffer.at(offset) != '\r' || buffer.at(offset + 1) != '\n') {
+                        success = false;
+                    } else {
+                        offset += 2;
+                        connection->parserState = ParserState::CHUNK_SIZE;
+                    }
+
+                    break;
+                }
+
+                case ParserState::BODY_UNTIL_CLOSE: {
+                    connection->body.append(buffer.constData() + offset, buffer.size() - offset);
+                    offset = buffer.size();
+                    more   = false;
+
+                    break;
+                }
+            }
+        }
+
+        buffer.remove(0, offset);
+        return success;
+    }
+
+
+    bool PipelinedHttpClient::startBody(Connection* connection) {
+        bool success = true;
+
+        if (connection->statusCode >= 100 && connection->statusCode < 200) {
+            // Interim response, the final response follows.
+            connection->headers.clear();
+            connection->parserState = ParserState::STATUS_LINE;
+        } else {
+            bool      isChunked     = false;
+            bool      hasLength     = false;
+            long long contentLength = 0;
+
+            for (  PipelinedNetworkReply::HeaderList::const_iterator it  = connection->headers.constBegin(),
+                                                                     end = connection->headers.constEnd()
+                 ; it != end && success
+                 ; ++it
+                ) {
+                QByteArray name = it->first.toLower();
+                if (name == "transfer-encoding") {
+                    isChunked = it->second.toLower().contains("chunked");
+                } else if (name == "content-length") {
+                    contentLength = it->second.toLongLong(&success);
+                    hasLength     = true;
+                } else if (name == "connection") {
+                    QByteArray value = it->second.toLower();
+                    if (value.contains("close")) {
+                        connection->closeAfterResponse = true;
+                    } else if (value.contains("keep-alive")) {
+                        connection->closeAfterResponse = false;
+                    }
+                }
+            }
+
+            if (success) {
+                if (connection->statusCode == 204 || connection->statusCode == 304) {
+                    connection->remainingBytes = 0;
+                    connection->parserState    = ParserState::BODY;
+                } else if (isChunked) {
+                    connection->parserState = ParserState::CHUNK_SIZE;
+                } else if (hasLength) {
+                    success                    = (contentLength >= 0);
+                    connection->remainingBytes = contentLength;
+                    connection->parserState    = ParserState::BODY;
+                } else {
+                    connection->closeAfterResponse = true;
+                    connection->parserState        = ParserState::BODY_UNTIL_CLOSE;
+                }
+            }
+        }
+
+        return success;
+    }
+
+
+    void PipelinedHttpClient::completeResponse(Connection* connection) {
+        QPointer<PipelinedNetworkReply>   reply        = connection->outstandingReplies.takeFirst();
+        int                               statusCode   = connection->statusCode;
+        QByteArray                        reasonPhrase = connection->reasonPhrase;
+        PipelinedNetworkReply::HeaderList headers      = connection->headers;
+        QByteArray                        body         = connection->body;
+
+        connection->parserState = ParserState::STATUS_LINE;
+        connection->headers.clear();
+        connection->body.clear();
+
+        if (!reply.isNull() && !reply->isFinished()) {
+            reply->setResponse(statusCode, reasonPhrase, headers, body);
+        }
+    }
+
+
+    void PipelinedHttpClient::closeConnection(
+            Connection*                 connection,
+            QNetworkReply::NetworkError networkError,
+            const QString&              errorString
+        ) {
+        connections.removeAll(connection);
+
+        connection->socket->disconnect(this);
+        if (connection->networkSocket != nullptr) {
+            connection->networkSocket->abort();
+        } else {
+            connection->localSocket->abort();
+        }
+
+        connection->socket->deleteLater();
+
+        QList<QPointer<PipelinedNetworkReply>> failedReplies;
+        failedReplies.swap(connection->outstandingReplies);
+
+        delete connection;
+
+        for (  QList<QPointer<PipelinedNetworkReply>>::const_iterator it  = failedReplies.constBegin(),
+                                                                      end = failedReplies.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            if (!it->isNull() && !(*it)->isFinished()) {
+                (*it)->setFailed(networkError, errorString);
+            }
+        }
+    }
+
+
+    QByteArray PipelinedHttpClient::headerBlock(const QNetworkRequest& request) {
+        QByteArray        result;
+        QList<QByteArray> headerNames = request.rawHeaderList();
+
+        bool isCacheable = true;
+        for (  QList<QByteArray>::const_iterator it  = headerNames.constBegin(),
+                                                 end = headerNames.constEnd()
+             ; it != end && isCacheable
+             ; ++it
+            ) {
+            isCacheable = (
+                   it->compare("User-Agent", Qt::CaseSensitivity::CaseInsensitive) == 0
+                || it->compare("Content-Type", Qt::CaseSensitivity::CaseInsensitive) == 0
+                || it->compare("Content-Length", Qt::CaseSensitivity::CaseInsensitive) == 0
+            );
+        }
+
+        QByteArray cacheKey;
+        if (isCacheable) {
+            cacheKey = request.rawHeader("User-Agent") + '\n' + request.rawHeader("Content-Type");
+            result   = headerBlockCache.value(cacheKey);
+        }
+
+        if (result.isEmpty()) {
+            for (  QList<QByteArray>::const_iterator it  = headerNames.constBegin(),
+                                                     end = headerNames.constEnd()
+                 ; it != end
+                 ; ++it
+                ) {
+                if (it->compare("Content-Length", Qt::CaseSensitivity::CaseInsensitive) != 0) {
+                    result.append(*it);
+                    result.append(": ");
+                    result.append(request.rawHeader(*it));
+                    result.append("\r\n");
+                }
+            }
+
+            if (isCacheable && headerBlockCache.size() < maximumHeaderBlockCacheSize) {
+                headerBlockCache.insert(cacheKey, result);
+            }
+        }
+
+        return result;
+    }
+}
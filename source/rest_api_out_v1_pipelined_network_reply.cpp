@@ -0,0 +1,172 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref RestApiOutV1::PipelinedNetworkReply class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QObject>
+#include <QMetaObject>
+#include <QString>
+#include <QByteArray>
+#include <QList>
+#include <QPair>
+#include <QNetworkAccessManager>
+#include <QNetworkRequest>
+#include <QNetworkReply>
+
+#include <cstring>
+#include <algorithm>
+
+#include "rest_api_out_v1_pipelined_network_reply.h"
+
+namespace RestApiOutV1 {
+    PipelinedNetworkReply::PipelinedNetworkReply(
+            const QNetworkRequest& request,
+            QObject*               parent
+        ):QNetworkReply(
+            parent
+        ) {
+        readOffset = 0;
+
+        setRequest(request);
+        setUrl(request.url());
+        setOperation(QNetworkAccessManager::Operation::PostOperation);
+        open(QIODevice::OpenModeFlag::ReadOnly | QIODevice::OpenModeFlag::Unbuffered);
+    }
+
+
+    PipelinedNetworkReply::~PipelinedNetworkReply() {}
+
+
+    void PipelinedNetworkReply::abort() {
+        if (!isFinished()) {
+            setFailed(QNetworkReply::NetworkError::OperationCanceledError, QString("Operation canceled"));
+        }
+    }
+
+
+    qint64 PipelinedNetworkReply::bytesAvailable() const {
+        return (responseBody.size() - readOffset) + QNetworkReply::bytesAvailable();
+    }
+
+
+    bool PipelinedNetworkReply::isSequential() const {
+        return true;
+    }
+
+
+    qint64 PipelinedNetworkReply::readData(char* data, qint64 maxSize) {
+        qint64 result;
+
+        if (readOffset < responseBody.size()) {
+            result = std::min(maxSize, static_cast<qint64>(responseBody.size()) - readOffset);
+            std::memcpy(data, responseBody.constData() + readOffset, static_cast<size_t>(result));
+            readOffset += result;
+        } else {
+            result = isFinished() ? -1 : 0;
+        }
+
+        return result;
+    }
+
+
+    void PipelinedNetworkReply::setResponse(
+            int               statusCode,
+            const QByteArray& reasonPhrase,
+            const HeaderList& headers,
+            const QByteArray& body
+        ) {
+        setAttribute(QNetworkRequest::Attribute::HttpStatusCodeAttribute, statusCode);
+        setAttribute(QNetworkRequest::Attribute::HttpReasonPhraseAttribute, reasonPhrase);
+
+        for (  HeaderList::const_iterator it  = headers.constBegin(),
+                                          end = headers.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            setRawHeader(it->first, it->second);
+        }
+
+        responseBody = body;
+        readOffset   = 0;
+
+        QNetworkReply::NetworkError networkError;
+        if (statusCode >= 200 && statusCode < 300) {
+            networkError = QNetworkReply::NetworkError::NoError;
+        } else if (statusCode == 401) {
+            networkError = QNetworkReply::NetworkError::AuthenticationRequiredError;
+        } else if (statusCode == 403) {
+            networkError = QNetworkReply::NetworkError::ContentAccessDenied;
+        } else if (statusCode == 404) {
+            networkError = QNetworkReply::NetworkError::ContentNotFoundError;
+        } else if (statusCode == 405) {
+            networkError = QNetworkReply::NetworkError::ContentOperationNotPermittedError;
+        } else if (statusCode == 407) {
+            networkError = QNetworkReply::NetworkError::ProxyAuthenticationRequiredError;
+        } else if (statusCode == 409) {
+            networkError = QNetworkReply::NetworkError::ContentConflictError;
+        } else if (statusCode == 410) {
+            networkError = QNetworkReply::NetworkError::ContentGoneError;
+        } else if (statusCode == 500) {
+            networkError = QNetworkReply::NetworkError::InternalServerError;
+        } else if (statusCode == 501) {
+            networkError = QNetworkReply::NetworkError::OperationNotImplementedError;
+        } else if (statusCode == 503) {
+            networkError = QNetworkReply::NetworkError::ServiceUnavailableError;
+        } else if (statusCode >= 500) {
+            networkError = QNetworkReply::NetworkError::UnknownServerError;
+        } else {
+            networkError = QNetworkReply::NetworkError::UnknownContentError;
+        }
+
+        if (networkError != QNetworkReply::NetworkError::NoError) {
+            setError(networkError, QString("Server replied: %1 %2").arg(statusCode).arg(QString(reasonPhrase)));
+        }
+
+        setFinished(true);
+
+        // Signals are always emitted from the event loop.  Transports can complete a reply while post() is still
+        // running, before the caller has connected to the reply, or while the transport is parsing its receive
+        // buffer.
+        QMetaObject::invokeMethod(
+            this,
+            [this]() {
+                emit metaDataChanged();
+                emit readyRead();
+                emit finished();
+            },
+            Qt::ConnectionType::QueuedConnection
+        );
+    }
+
+
+    void PipelinedNetworkReply::setFailed(QNetworkReply::NetworkError networkError, const QString& errorString) {
+        setError(networkError, errorString);
+        setFinished(true);
+
+        QMetaObject::invokeMethod(
+            this,
+            [this]() {
+                emit finished();
+            },
+            Qt::ConnectionType::QueuedConnection
+        );
+    }
+}
@@ -26,6 +26,10 @@
 #include <QCoreApplication>
 #include <QString>
 #include <QDateTime>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QSaveFile>
+#include <QSysInfo>
 #include <QByteArray>
 #include <QJsonDocument>
 #include <QJsonObject>
@@ -35,24 +39,67 @@
 #include <QNetworkReply>
 #include <QMutex>
 #include <QMutexLocker>
+#include <QRandomGenerator>
+#include <QThread>
+#include <QMetaObject>
+#include <QCryptographicHash>
+
+#ifndef QT_NO_SSL
+    #include <QSslConfiguration>
+#endif
+
+#include <QHttp2Configuration>
 
 #include <cstring>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <functional>
 
 #include <crypto_aes_cbc_encryptor.h>
 #include <crypto_hmac.h>
 #include <crypto_helpers.h>
 
+#include "rest_api_out_v1_time_delta_estimator.h"
 #include "rest_api_out_v1_server.h"
+#include "rest_api_out_v1_server_group.h"
+#include "rest_api_out_v1_pipelined_http_client.h"
+#include "rest_api_out_v1_transport.h"
 
 /***********************************************************************************************************************
  * Server::RestApi
  */
 
 namespace RestApiOutV1 {
-    Server::RestApi::RestApi(Server* server):currentServer(server) {}
+    Server::RestApi::RestApi(Server* server):currentServer(server),currentServerGroup(nullptr) {}
+
+
+    Server::RestApi::~RestApi() {
+        if (!currentServerGroup.isNull()) {
+            QList<Server*> servers = currentServerGroup->servers();
+            for (  QList<Server*>::const_iterator it  = servers.constBegin(),
+                                                  end = servers.constEnd()
+                 ; it != end
+                 ; ++it
+                ) {
+                (*it)->removeRestApi(this);
+            }
+        }
+
+        if (!currentServer.isNull()) {
+            currentServer->removeRestApi(this);
+        }
+    }
 
 
-    Server::RestApi::~RestApi() {}
+    void Server::RestApi::setServerGroup(ServerGroup* newServerGroup) {
+        currentServerGroup = newServerGroup;
+    }
+
+
+    ServerGroup* Server::RestApi::serverGroup() const {
+        return currentServerGroup;
+    }
 
 
     bool Server::RestApi::isTimestampAccurate() {
@@ -65,6 +112,26 @@ namespace RestApiOutV1 {
     }
 
 
+    void Server::RestApi::selectServer() {
+        if (!currentServerGroup.isNull()) {
+            Server* selectedServer = currentServerGroup->selectServer();
+            if (selectedServer != nullptr) {
+                currentServer = selectedServer;
+            }
+        }
+    }
+
+
+    void Server::RestApi::reportResponse(const QNetworkReply* reply, long long latency) {
+        currentServer->recordResponse(reply, latency);
+    }
+
+
+    void Server::RestApi::reportAuthenticationFailure(long long signatureMargin) {
+        currentServer->recordAuthenticationFailure(signatureMargin);
+    }
+
+
     void Server::RestApi::timestampUpdated() {}
 
 
@@ -85,6 +152,19 @@ namespace RestApiOutV1 {
     const QString  Server::defaultUserAgent("Inesonic, LLC");
     const QString  Server::defaultTimeDeltaSlug("/td");
 
+    const unsigned long Server::defaultTimeDeltaCacheMaximumAge = 24 * 60 * 60;
+
+    static std::atomic<unsigned long long> nextSecretGeneration(1);
+
+    const unsigned long      Server::defaultMinimumConcurrencyLimit = 1;
+    const unsigned long      Server::defaultMaximumConcurrencyLimit = 256;
+    const unsigned long long Server::rejectedTicket                 = static_cast<unsigned long long>(-1);
+
+    /**
+     * Tolerance, in mSec, used to decide if the wall clock was stepped since a time delta snapshot was taken.
+     */
+    static const long long clockStepTolerance = 1000;
+
     Server::Server(
             QNetworkAccessManager* networkAccessManager,
             const QUrl&            serverSchemeAndHost,
@@ -101,13 +181,85 @@ namespace RestApiOutV1 {
         ),currentDefaultSecret(
             QByteArray()
         ) {
+        defaultSecretGeneration = 0;
+
         currentUserAgent = defaultUserAgent;
         currentTimeDelta = 0;
 
-        currentNetworkAccessManager->setRedirectPolicy(QNetworkRequest::RedirectPolicy::NoLessSafeRedirectPolicy);
-        currentNetworkAccessManager->setStrictTransportSecurityEnabled(false);
+        configureNetworkAccessManager(currentNetworkAccessManager);
 
-        pendingReply = nullptr;
+        networkAccessManagerPool.append(currentNetworkAccessManager);
+        currentShardingPolicy         = ShardingPolicy::ROUND_ROBIN;
+        nextNetworkAccessManagerIndex = 0;
+
+        pendingReply           = nullptr;
+        backgroundRequest      = false;
+        timestampUpdatePending = false;
+
+        currentTransitTime         = 0;
+        signedRequestCount         = 0;
+        authenticationFailureCount = 0;
+        boundaryMissCount          = 0;
+
+        currentAverageLatency  = -1;
+        currentErrorRate       = 0;
+        currentNumberResponses = 0;
+        nextLatencySampleIndex = 0;
+
+        currentRefreshInterval = 0;
+        currentRefreshJitter   = 0;
+
+        currentResumeBatchSize = 0;
+        currentResumeInterval  = 0;
+
+        resumeTimer.setSingleShot(true);
+        connect(&resumeTimer, &QTimer::timeout, this, &Server::resumeWaitingRestApis);
+
+        currentPassiveTrackingEnabled = false;
+        nextPassiveSampleIndex        = 0;
+
+        refreshTimer.setSingleShot(true);
+        connect(&refreshTimer, &QTimer::timeout, this, &Server::refreshTimeDelta);
+
+        rateLimitTimer.setSingleShot(true);
+        connect(&rateLimitTimer, &QTimer::timeout, this, &Server::dispatchScheduled);
+
+        // The timers are made children so that they follow this server if it's moved to a network thread.
+        resumeTimer.setParent(this);
+        refreshTimer.setParent(this);
+        rateLimitTimer.setParent(this);
+
+        drainScheduled             = false;
+        currentNetworkThread       = nullptr;
+        currentPipelinedHttpClient = nullptr;
+        currentTransport           = nullptr;
+
+        currentMaximumInFlightRequests = 0;
+        nextScheduleTicket             = 1;
+        dispatchingScheduled           = false;
+
+        currentMaximumScheduledRequests   = 0;
+        currentAdaptiveConcurrencyEnabled = false;
+        currentConcurrencyLimit           = initialConcurrencyLimit;
+        currentMinimumConcurrencyLimit    = defaultMinimumConcurrencyLimit;
+        currentMaximumConcurrencyLimit    = defaultMaximumConcurrencyLimit;
+        baselineLatency                   = -1;
+
+        rateLimitClock.start();
+
+        currentHttp2Enabled                  = false;
+        currentHttp2StreamReceiveWindowSize  = 0;
+        currentHttp2SessionReceiveWindowSize = 0;
+        currentHttp2MaximumFrameSize         = 0;
+
+        #ifndef QT_NO_SSL
+            connect(
+                currentNetworkAccessManager,
+                &QNetworkAccessManager::encrypted,
+                this,
+                &Server::connectionEncrypted
+            );
+        #endif
     }
 
 
@@ -130,24 +282,145 @@ namespace RestApiOutV1 {
         currentUserAgent = defaultUserAgent;
         currentTimeDelta = 0;
 
-        currentNetworkAccessManager->setRedirectPolicy(QNetworkRequest::RedirectPolicy::NoLessSafeRedirectPolicy);
-        currentNetworkAccessManager->setStrictTransportSecurityEnabled(false);
+        configureNetworkAccessManager(currentNetworkAccessManager);
+
+        networkAccessManagerPool.append(currentNetworkAccessManager);
+        currentShardingPolicy         = ShardingPolicy::ROUND_ROBIN;
+        nextNetworkAccessManagerIndex = 0;
+
+        pendingReply           = nullptr;
+        backgroundRequest      = false;
+        timestampUpdatePending = false;
+
+        currentTransitTime         = 0;
+        signedRequestCount         = 0;
+        authenticationFailureCount = 0;
+        boundaryMissCount          = 0;
+
+        currentAverageLatency  = -1;
+        currentErrorRate       = 0;
+        currentNumberResponses = 0;
+        nextLatencySampleIndex = 0;
+
+        currentRefreshInterval = 0;
+        currentRefreshJitter   = 0;
+
+        currentResumeBatchSize = 0;
+        currentResumeInterval  = 0;
+
+        resumeTimer.setSingleShot(true);
+        connect(&resumeTimer, &QTimer::timeout, this, &Server::resumeWaitingRestApis);
+
+        currentPassiveTrackingEnabled = false;
+        nextPassiveSampleIndex        = 0;
+
+        refreshTimer.setSingleShot(true);
+        connect(&refreshTimer, &QTimer::timeout, this, &Server::refreshTimeDelta);
+
+        rateLimitTimer.setSingleShot(true);
+        connect(&rateLimitTimer, &QTimer::timeout, this, &Server::dispatchScheduled);
+
+        // The timers are made children so that they follow this server if it's moved to a network thread.
+        resumeTimer.setParent(this);
+        refreshTimer.setParent(this);
+        rateLimitTimer.setParent(this);
+
+        drainScheduled             = false;
+        currentNetworkThread       = nullptr;
+        currentPipelinedHttpClient = nullptr;
+        currentTransport           = nullptr;
+
+        currentMaximumInFlightRequests = 0;
+        nextScheduleTicket             = 1;
+        dispatchingScheduled           = false;
+
+        currentMaximumScheduledRequests   = 0;
+        currentAdaptiveConcurrencyEnabled = false;
+        currentConcurrencyLimit           = initialConcurrencyLimit;
+        currentMinimumConcurrencyLimit    = defaultMinimumConcurrencyLimit;
+        currentMaximumConcurrencyLimit    = defaultMaximumConcurrencyLimit;
+        baselineLatency                   = -1;
+
+        rateLimitClock.start();
+
+        currentHttp2Enabled                  = false;
+        currentHttp2StreamReceiveWindowSize  = 0;
+        currentHttp2SessionReceiveWindowSize = 0;
+        currentHttp2MaximumFrameSize         = 0;
 
-        pendingReply = nullptr;
+        #ifndef QT_NO_SSL
+            connect(
+                currentNetworkAccessManager,
+                &QNetworkAccessManager::encrypted,
+                this,
+                &Server::connectionEncrypted
+            );
+        #endif
+    }
+
+
+    Server::Server(
+            QNetworkAccessManager* networkAccessManager,
+            const QUrl&            serverSchemeAndHost,
+            const QString&         timeDeltaSlug,
+            const QString&         timeDeltaCacheFile,
+            unsigned long          maximumAge,
+            QObject*               parent
+        ):Server(
+            networkAccessManager,
+            serverSchemeAndHost,
+            timeDeltaSlug,
+            parent
+        ) {
+        setTimeDeltaCacheFile(timeDeltaCacheFile, maximumAge);
+    }
+
+
+    Server::Server(
+            QNetworkAccessManager* networkAccessManager,
+            const QUrl&            serverSchemeAndHost,
+            const QByteArray&      defaultSecret,
+            const QString&         timeDeltaSlug,
+            const QString&         timeDeltaCacheFile,
+            unsigned long          maximumAge,
+            QObject*               parent
+        ):Server(
+            networkAccessManager,
+            serverSchemeAndHost,
+            defaultSecret,
+            timeDeltaSlug,
+            parent
+        ) {
+        setTimeDeltaCacheFile(timeDeltaCacheFile, maximumAge);
     }
 
 
     Server::~Server() {
+        if (currentNetworkThread != nullptr) {
+            if (QThread::currentThread() != currentNetworkThread) {
+                currentNetworkThread->quit();
+                currentNetworkThread->wait();
+                delete currentNetworkThread;
+            } else {
+                currentNetworkThread->quit();
+                connect(currentNetworkThread, &QThread::finished, currentNetworkThread, &QThread::deleteLater);
+            }
+        }
+
         Crypto::scrub(currentDefaultSecret);
     }
 
 
     void Server::setDefaultSecret(const QByteArray& newDefaultSecret) {
+        Q_ASSERT(QThread::currentThread() == thread());
         Q_ASSERT(static_cast<unsigned>(newDefaultSecret.size()) == secretLength);
 
         Crypto::scrub(currentDefaultSecret);
         currentDefaultSecret.resize(hmacBlockSize);
         memcpy(currentDefaultSecret.data(), newDefaultSecret.data(), secretLength);
+
+        defaultSecretRateKey    = rateLimitKey(newDefaultSecret);
+        defaultSecretGeneration = nextSecretGeneration.fetch_add(1, std::memory_order_relaxed);
     }
 
 
@@ -156,8 +429,202 @@ namespace RestApiOutV1 {
     }
 
 
+    void Server::setNetworkAccessManagerPoolSize(unsigned newPoolSize) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
+        unsigned poolSize = std::max(newPoolSize, 1U);
+
+        while (static_cast<unsigned>(networkAccessManagerPool.size()) > poolSize) {
+            // Deleting a manager with replies in flight destroys or orphans those replies so managers still in use
+            // are drained first.  See poolReplyFinished.
+            QNetworkAccessManager* manager = networkAccessManagerPool.takeLast();
+            if (poolReplyCounts.value(manager) == 0) {
+                poolReplyCounts.remove(manager);
+                manager->deleteLater();
+            }
+        }
+
+        while (static_cast<unsigned>(networkAccessManagerPool.size()) < poolSize) {
+            QNetworkAccessManager* manager = new QNetworkAccessManager(this);
+            configureNetworkAccessManager(manager);
+
+            #ifndef QT_NO_SSL
+                connect(manager, &QNetworkAccessManager::encrypted, this, &Server::connectionEncrypted);
+            #endif
+
+            connect(manager, &QNetworkAccessManager::finished, this, [this, manager]() {
+                poolReplyFinished(manager);
+            });
+
+            poolReplyCounts.insert(manager, 0);
+            networkAccessManagerPool.append(manager);
+        }
+    }
+
+
+    unsigned Server::networkAccessManagerPoolSize() const {
+        return static_cast<unsigned>(networkAccessManagerPool.size());
+    }
+
+
+    void Server::setShardingPolicy(Server::ShardingPolicy newShardingPolicy) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
+        currentShardingPolicy = newShardingPolicy;
+    }
+
+
+    Server::ShardingPolicy Server::shardingPolicy() const {
+        return currentShardingPolicy;
+    }
+
+
+    void Server::setPipelinedTransportEnabled(bool nowEnabled) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
+        if (nowEnabled) {
+            if (currentPipelinedHttpClient == nullptr) {
+                currentPipelinedHttpClient = new PipelinedHttpClient(currentSchemeAndHost, this);
+            }
+        } else if (currentPipelinedHttpClient != nullptr) {
+            currentPipelinedHttpClient->deleteLater();
+            currentPipelinedHttpClient = nullptr;
+        }
+    }
+
+
+    void Server::setPipelinedTransportDisabled(bool nowDisabled) {
+        setPipelinedTransportEnabled(!nowDisabled);
+    }
+
+
+    bool Server::pipelinedTransportEnabled() const {
+        return currentPipelinedHttpClient != nullptr;
+    }
+
+
+    bool Server::pipelinedTransportDisabled() const {
+        return currentPipelinedHttpClient == nullptr;
+    }
+
+
+    PipelinedHttpClient* Server::pipelinedHttpClient() const {
+        return currentPipelinedHttpClient;
+    }
+
+
+    void Server::setTransport(Transport* newTransport) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
+        currentTransport = newTransport;
+    }
+
+
+    Transport* Server::transport() const {
+        return currentTransport;
+    }
+
+
+    bool Server::setHttp2Enabled(bool nowEnabled) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
+        currentHttp2Enabled = nowEnabled;
+        return !nowEnabled || http2Applies();
+    }
+
+
+    bool Server::setHttp2Disabled(bool nowDisabled) {
+        return setHttp2Enabled(!nowDisabled);
+    }
+
+
+    bool Server::http2Enabled() const {
+        return currentHttp2Enabled;
+    }
+
+
+    bool Server::http2Disabled() const {
+        return !currentHttp2Enabled;
+    }
+
+
+    bool Server::setHttp2StreamReceiveWindowSize(unsigned newWindowSize) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
+        unsigned previousValue = currentHttp2StreamReceiveWindowSize;
+
+        currentHttp2StreamReceiveWindowSize = newWindowSize;
+        bool success = updateHttp2Configuration();
+        if (!success) {
+            currentHttp2StreamReceiveWindowSize = previousValue;
+            updateHttp2Configuration();
+        }
+
+        return success && http2Applies();
+    }
+
+
+    unsigned Server::http2StreamReceiveWindowSize() const {
+        return currentHttp2StreamReceiveWindowSize;
+    }
+
+
+    bool Server::setHttp2SessionReceiveWindowSize(unsigned newWindowSize) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
+        unsigned previousValue = currentHttp2SessionReceiveWindowSize;
+
+        currentHttp2SessionReceiveWindowSize = newWindowSize;
+        bool success = updateHttp2Configuration();
+        if (!success) {
+            currentHttp2SessionReceiveWindowSize = previousValue;
+            updateHttp2Configuration();
+        }
+
+        return success && http2Applies();
+    }
+
+
+    unsigned Server::http2SessionReceiveWindowSize() const {
+        return currentHttp2SessionReceiveWindowSize;
+    }
+
+
+    bool Server::setHttp2MaximumFrameSize(unsigned newFrameSize) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
+        unsigned previousValue = currentHttp2MaximumFrameSize;
+
+        currentHttp2MaximumFrameSize = newFrameSize;
+        bool success = updateHttp2Configuration();
+        if (!success) {
+            currentHttp2MaximumFrameSize = previousValue;
+            updateHttp2Configuration();
+        }
+
+        return success && http2Applies();
+    }
+
+
+    unsigned Server::http2MaximumFrameSize() const {
+        return currentHttp2MaximumFrameSize;
+    }
+
+
     void Server::setSchemeAndHost(const QUrl& newSchemeAndHost) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
         currentSchemeAndHost = newSchemeAndHost;
+
+        if (currentPipelinedHttpClient != nullptr) {
+            PipelinedHttpClient* oldClient = currentPipelinedHttpClient;
+
+            currentPipelinedHttpClient = new PipelinedHttpClient(currentSchemeAndHost, this);
+            currentPipelinedHttpClient->setNumberConnections(oldClient->numberConnections());
+            currentPipelinedHttpClient->setMaximumPipelineDepth(oldClient->maximumPipelineDepth());
+
+            oldClient->deleteLater();
+        }
     }
 
 
@@ -167,6 +634,8 @@ namespace RestApiOutV1 {
 
 
     void Server::setUserAgent(const QString& newUserAgent) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
         currentUserAgent = newUserAgent;
     }
 
@@ -177,6 +646,8 @@ namespace RestApiOutV1 {
 
 
     void Server::setTimeDeltaSlug(const QString& newTimeDeltaSlug) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
         currentTimeDeltaSlug = newTimeDeltaSlug;
     }
 
@@ -195,130 +666,1257 @@ namespace RestApiOutV1 {
 
 
     void Server::setTimeDelta(long long newTimeDelta) {
-        currentTimeDelta = newTimeDelta;
+        currentTimeDelta = 1000 * newTimeDelta;
     }
 
 
     long long Server::timeDelta() {
-        return currentTimeDelta;
+        return qRound64(currentTimeDelta.load(std::memory_order_relaxed) / 1000.0);
     }
 
 
-    void Server::updateTimeDelta(RestApi* restApi) {
+    long long Server::timeDeltaMilliseconds() {
+        return currentTimeDelta.load(std::memory_order_relaxed);
+    }
+
+
+    long long Server::timeDeltaUncertainty() {
         QMutexLocker locker(&requestMutex);
+        return timeDeltaEstimator.uncertainty();
+    }
 
-        if (pendingReply == nullptr) {
-            retriesRemaining = numberRetries;
-            issueTimeDeltaRequest();
-        }
 
-        waitingRestApis.append(restApi);
+    long long Server::timeDeltaRoundTripTime() {
+        QMutexLocker locker(&requestMutex);
+        return timeDeltaEstimator.roundTripTime();
     }
 
 
-    bool Server::checkTimestamp(RestApi* restApi) {
-        bool result;
+    long long Server::expectedTransitTime() const {
+        return currentTransitTime.load(std::memory_order_relaxed);
+    }
 
-        QMutexLocker locker(&requestMutex);
-        if (pendingReply == nullptr) {
-            result = true;
-        } else {
-            result = false;
-            waitingRestApis.append(restApi);
-        }
 
-        return result;
+    unsigned long long Server::signedRequests() const {
+        return signedRequestCount.load(std::memory_order_relaxed);
     }
 
 
-    void Server::issueTimeDeltaRequest() {
-        QNetworkRequest request(timeDeltaUrl());
+    unsigned long long Server::authenticationFailures() const {
+        return authenticationFailureCount.load(std::memory_order_relaxed);
+    }
 
-        QJsonObject jsonObject;
-        jsonObject.insert("timestamp", static_cast<double>(QDateTime::currentSecsSinceEpoch()));
 
-        QByteArray message = QJsonDocument(jsonObject).toJson(QJsonDocument::JsonFormat::Compact);
+    unsigned long long Server::signingWindowBoundaryMisses() const {
+        return boundaryMissCount.load(std::memory_order_relaxed);
+    }
 
-        request.setHeader(QNetworkRequest::KnownHeaders::UserAgentHeader, currentUserAgent);
-        request.setHeader(QNetworkRequest::KnownHeaders::ContentTypeHeader, "application/json");
-        request.setHeader(QNetworkRequest::KnownHeaders::ContentLengthHeader, message.size());
-        request.setRawHeader("Accept", "*/*");
 
-        request.setTransferTimeout();
+    double Server::averageLatency() const {
+        QMutexLocker locker(&statisticsMutex);
+        return currentAverageLatency;
+    }
 
-        currentNetworkAccessManager->setRedirectPolicy(QNetworkRequest::RedirectPolicy::NoLessSafeRedirectPolicy);
-        currentNetworkAccessManager->setStrictTransportSecurityEnabled(false);
 
-        pendingReply = currentNetworkAccessManager->post(request, message);
-        pendingReply->setParent(this);
+    double Server::errorRate() const {
+        QMutexLocker locker(&statisticsMutex);
+        return currentErrorRate;
+    }
 
-        connect(pendingReply, &QNetworkReply::finished, this, &Server::responseReceived);
+
+    unsigned long long Server::numberResponses() const {
+        QMutexLocker locker(&statisticsMutex);
+        return currentNumberResponses;
     }
 
 
-    void Server::responseReceived() {
-        QNetworkReply::NetworkError networkError = pendingReply->error();
-        bool                        success;
+    long long Server::latencyPercentile(double percentile) const {
+        long long result;
 
-        if (networkError == QNetworkReply::NetworkError::NoError) {
-            QByteArray receivedData = pendingReply->readAll();
+        statisticsMutex.lock();
+        QList<long long> samples = latencySamples;
+        statisticsMutex.unlock();
 
-            QJsonParseError parseError;
-            QJsonDocument   jsonDocument = QJsonDocument::fromJson(receivedData, &parseError);
-            if (parseError.error == QJsonParseError::NoError) {
-                success = parseResponse(jsonDocument);
-            } else {
-                success = false;
-            }
+        if (!samples.isEmpty()) {
+            int lastIndex = static_cast<int>(samples.size()) - 1;
+            int index     = static_cast<int>((percentile / 100.0) * lastIndex + 0.5);
+
+            index = std::max(0, std::min(index, lastIndex));
+
+            std::nth_element(samples.begin(), samples.begin() + index, samples.end());
+            result = samples.at(index);
         } else {
-            success = false;
+            result = -1;
         }
 
-        pendingReply->deleteLater();
+        return result;
+    }
 
-        if (!success) {
-            if (retriesRemaining > 0) {
-                --retriesRemaining;
-                issueTimeDeltaRequest();
-            } else {
-                requestMutex.lock();
 
-                for (  QList<RestApi*>::const_iterator it  = waitingRestApis.constBegin(),
-                                                       end = waitingRestApis.constEnd()
-                     ; it != end
-                     ; ++it
-                    ) {
-                    (*it)->timestampUpdateFailed();
-                }
+    void Server::resetStatistics(double initialLatency) {
+        QMutexLocker locker(&statisticsMutex);
 
-                waitingRestApis.clear();
+        currentAverageLatency  = initialLatency < 0 ? -1 : initialLatency;
+        currentErrorRate       = 0;
+        currentNumberResponses = 0;
+        nextLatencySampleIndex = 0;
 
-                pendingReply = nullptr;
-                requestMutex.unlock();
+        latencySamples.clear();
+    }
 
-                emit timeDeltaUpdateFailed();
-            }
+
+    void Server::setTimeDeltaRefreshInterval(unsigned long newInterval, unsigned long newJitter) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
+        currentRefreshInterval = newInterval;
+        currentRefreshJitter   = newJitter;
+
+        scheduleTimeDeltaRefresh();
+    }
+
+
+    unsigned long Server::timeDeltaRefreshInterval() const {
+        return currentRefreshInterval;
+    }
+
+
+    unsigned long Server::timeDeltaRefreshJitter() const {
+        return currentRefreshJitter;
+    }
+
+
+    void Server::setPassiveTimeDeltaTrackingEnabled(bool nowEnabled) {
+        QMutexLocker locker(&requestMutex);
+
+        currentPassiveTrackingEnabled = nowEnabled;
+        passiveSamples.clear();
+        nextPassiveSampleIndex = 0;
+    }
+
+
+    void Server::setPassiveTimeDeltaTrackingDisabled(bool nowDisabled) {
+        setPassiveTimeDeltaTrackingEnabled(!nowDisabled);
+    }
+
+
+    bool Server::passiveTimeDeltaTrackingEnabled() const {
+        return currentPassiveTrackingEnabled;
+    }
+
+
+    bool Server::passiveTimeDeltaTrackingDisabled() const {
+        return !currentPassiveTrackingEnabled;
+    }
+
+
+    void Server::setResumePacing(unsigned newBatchSize, unsigned long newInterval) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
+        currentResumeBatchSize = newBatchSize;
+        currentResumeInterval  = newInterval;
+    }
+
+
+    unsigned Server::resumeBatchSize() const {
+        return currentResumeBatchSize;
+    }
+
+
+    unsigned long Server::resumeInterval() const {
+        return currentResumeInterval;
+    }
+
+
+    void Server::refreshTimeDelta() {
+        QMutexLocker locker(&requestMutex);
+
+        if (pendingReply == nullptr) {
+            retriesRemaining  = numberRetries;
+            backgroundRequest = true;
+            issueTimeDeltaRequest();
+        }
+    }
+
+
+    bool Server::setTimeDeltaCacheFile(const QString& newFilename, unsigned long maximumAge) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
+        bool success;
+
+        currentTimeDeltaCacheFile = newFilename;
+        if (!newFilename.isEmpty()) {
+            success = loadTimeDeltaCache(maximumAge);
+            if (success) {
+                refreshTimeDelta();
+            }
+        } else {
+            success = false;
+        }
+
+        return success;
+    }
+
+
+    const QString& Server::timeDeltaCacheFile() const {
+        return currentTimeDeltaCacheFile;
+    }
+
+
+    QNetworkReply* Server::post(const QNetworkRequest& request, const QByteArray& payload) {
+        QNetworkReply* reply;
+
+        if (currentTransport != nullptr) {
+            reply = currentTransport->post(request, payload);
+        } else if (currentPipelinedHttpClient != nullptr) {
+            reply = currentPipelinedHttpClient->post(request, payload);
+        } else {
+            reply = post(selectNetworkAccessManager(request), request, payload);
+        }
+
+        return reply;
+    }
+
+
+    void Server::setMaximumInFlightRequests(unsigned long newMaximumInFlightRequests) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
+        currentMaximumInFlightRequests = newMaximumInFlightRequests;
+        dispatchScheduled();
+    }
+
+
+    unsigned long Server::maximumInFlightRequests() const {
+        return currentMaximumInFlightRequests;
+    }
+
+
+    unsigned long Server::numberInFlightRequests() const {
+        return static_cast<unsigned long>(inFlightReplies.size());
+    }
+
+
+    unsigned long Server::numberScheduledRequests() const {
+        return static_cast<unsigned long>(scheduledTickets.size());
+    }
+
+
+    void Server::setAdaptiveConcurrencyEnabled(bool nowEnabled) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
+        if (nowEnabled != currentAdaptiveConcurrencyEnabled) {
+            double initialLimit = initialConcurrencyLimit; // Copy so std::min does not odr-use the constant.
+
+            currentAdaptiveConcurrencyEnabled = nowEnabled;
+            currentConcurrencyLimit           = std::max(
+                static_cast<double>(currentMinimumConcurrencyLimit),
+                std::min(static_cast<double>(currentMaximumConcurrencyLimit), initialLimit)
+            );
+            baselineLatency                   = -1;
+
+            concurrencyDecreaseTimer.invalidate();
+            dispatchScheduled();
+        }
+    }
+
+
+    void Server::setAdaptiveConcurrencyDisabled(bool nowDisabled) {
+        setAdaptiveConcurrencyEnabled(!nowDisabled);
+    }
+
+
+    bool Server::adaptiveConcurrencyEnabled() const {
+        return currentAdaptiveConcurrencyEnabled;
+    }
+
+
+    bool Server::adaptiveConcurrencyDisabled() const {
+        return !currentAdaptiveConcurrencyEnabled;
+    }
+
+
+    void Server::setConcurrencyLimitBounds(unsigned long minimumLimit, unsigned long maximumLimit) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
+        currentMinimumConcurrencyLimit = std::max(minimumLimit, 1UL);
+        currentMaximumConcurrencyLimit = std::max(maximumLimit, currentMinimumConcurrencyLimit);
+        currentConcurrencyLimit        = std::max(
+            static_cast<double>(currentMinimumConcurrencyLimit),
+            std::min(static_cast<double>(currentMaximumConcurrencyLimit), currentConcurrencyLimit)
+        );
+
+        dispatchScheduled();
+    }
+
+
+    unsigned long Server::minimumConcurrencyLimit() const {
+        return currentMinimumConcurrencyLimit;
+    }
+
+
+    unsigned long Server::maximumConcurrencyLimit() const {
+        return currentMaximumConcurrencyLimit;
+    }
+
+
+    unsigned long Server::concurrencyLimit() const {
+        return static_cast<unsigned long>(currentConcurrencyLimit);
+    }
+
+
+    void Server::setMaximumScheduledRequests(unsigned long newMaximumScheduledRequests) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
+        currentMaximumScheduledRequests = newMaximumScheduledRequests;
+    }
+
+
+    unsigned long Server::maximumScheduledRequests() const {
+        return currentMaximumScheduledRequests;
+    }
+
+
+    void Server::setEndpointRateLimit(const QString& endpoint, double requestsPerSecond, double burstSize) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
+        if (requestsPerSecond > 0) {
+            TokenBucket bucket;
+            bucket.rate       = requestsPerSecond / 1000.0;
+            bucket.capacity   = std::max(burstSize, 1.0);
+            bucket.tokens     = bucket.capacity;
+            bucket.lastUpdate = rateLimitClock.elapsed();
+
+            endpointBuckets.insert(endpoint, bucket);
+        } else {
+            endpointBuckets.remove(endpoint);
+        }
+
+        dispatchScheduled();
+    }
+
+
+    void Server::setSecretRateLimit(const QByteArray& secret, double requestsPerSecond, double burstSize) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
+        QByteArray key = secret.isEmpty() ? defaultSecretRateKey : rateLimitKey(secret);
+
+        if (requestsPerSecond > 0) {
+            TokenBucket bucket;
+            bucket.rate       = requestsPerSecond / 1000.0;
+            bucket.capacity   = std::max(burstSize, 1.0);
+            bucket.tokens     = bucket.capacity;
+            bucket.lastUpdate = rateLimitClock.elapsed();
+
+            secretBuckets.insert(key, bucket);
+        } else {
+            secretBuckets.remove(key);
+        }
+
+        dispatchScheduled();
+    }
+
+
+    double Server::remainingEndpointBudget(const QString& endpoint) const {
+        QHash<QString, TokenBucket>::const_iterator it = endpointBuckets.constFind(endpoint);
+        return it != endpointBuckets.constEnd() ? availableTokens(it.value(), rateLimitClock.elapsed()) : -1;
+    }
+
+
+    double Server::remainingSecretBudget(const QByteArray& secret) const {
+        QByteArray key = secret.isEmpty() ? defaultSecretRateKey : rateLimitKey(secret);
+
+        QHash<QByteArray, TokenBucket>::const_iterator it = secretBuckets.constFind(key);
+        return it != secretBuckets.constEnd() ? availableTokens(it.value(), rateLimitClock.elapsed()) : -1;
+    }
+
+
+    QByteArray Server::rateLimitKey(const QByteArray& secret) {
+        return QCryptographicHash::hash(
+            secret.left(static_cast<int>(secretLength)),
+            QCryptographicHash::Algorithm::Sha256
+        );
+    }
+
+
+    unsigned long long Server::schedule(
+            Server::Priority      priority,
+            const void*           source,
+            const Server::Issuer& issuer,
+            const QString&        endpoint,
+            const QByteArray&     secretKey
+        ) {
+        unsigned long long ticket;
+
+        if (scheduledTickets.isEmpty() && inFlightSlotAvailable() && rateLimitDelay(endpoint, secretKey) == 0) {
+            consumeTokens(endpoint, secretKey);
+            issueScheduled(issuer);
+            ticket = 0;
+        } else if (currentMaximumScheduledRequests != 0                                                    &&
+                   static_cast<unsigned long>(scheduledTickets.size()) >= currentMaximumScheduledRequests    ) {
+            ticket = rejectedTicket;
+        } else {
+            ticket = nextScheduleTicket++;
+
+            QList<ScheduledSource>&          sources = scheduledSources[priority];
+            QList<ScheduledSource>::iterator it      = sources.begin();
+            QList<ScheduledSource>::iterator end     = sources.end();
+            while (it != end && it->source != source) {
+                ++it;
+            }
+
+            if (it == end) {
+                ScheduledSource scheduledSource;
+                scheduledSource.source = source;
+                sources.append(scheduledSource);
+
+                it = sources.end() - 1;
+            }
+
+            ScheduledRequest scheduledRequest;
+            scheduledRequest.ticket    = ticket;
+            scheduledRequest.issuer    = issuer;
+            scheduledRequest.endpoint  = endpoint;
+            scheduledRequest.secretKey = secretKey;
+
+            it->requests.append(scheduledRequest);
+            scheduledTickets.insert(ticket, priority);
+
+            if (inFlightSlotAvailable()) {
+                // The request is only waiting on the rate limits.
+                startRateLimitTimer(rateLimitDelay(endpoint, secretKey));
+            }
+        }
+
+        return ticket;
+    }
+
+
+    bool Server::cancelScheduled(unsigned long long ticket) {
+        bool success = scheduledTickets.contains(ticket);
+
+        if (success) {
+            Priority                         priority = scheduledTickets.take(ticket);
+            QList<ScheduledSource>&          sources  = scheduledSources[priority];
+            QList<ScheduledSource>::iterator it       = sources.begin();
+            bool                             found    = false;
+            while (!found && it != sources.end()) {
+                QList<ScheduledRequest>::iterator requestIterator = it->requests.begin();
+                while (!found && requestIterator != it->requests.end()) {
+                    if (requestIterator->ticket == ticket) {
+                        it->requests.erase(requestIterator);
+                        found = true;
+                    } else {
+                        ++requestIterator;
+                    }
+                }
+
+                if (found && it->requests.isEmpty()) {
+                    sources.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+
+            if (sources.isEmpty()) {
+                scheduledSources.remove(priority);
+            }
+        }
+
+        return success;
+    }
+
+
+    QNetworkReply* Server::post(
+            QNetworkAccessManager* manager,
+            const QNetworkRequest& request,
+            const QByteArray&      payload
+        ) {
+        QNetworkReply* reply;
+        bool           useTlsSessionCache = false;
+
+        #ifndef QT_NO_SSL
+            useTlsSessionCache = !currentTlsSessionCacheFile.isEmpty() && request.url().scheme() == QString("https");
+        #endif
+
+        if (!useTlsSessionCache && !currentHttp2Enabled) {
+            reply = manager->post(request, payload);
+        } else {
+            QNetworkRequest configuredRequest(request);
+
+            #ifndef QT_NO_SSL
+                if (useTlsSessionCache) {
+                    configuredRequest.setSslConfiguration(currentSslConfiguration);
+                }
+            #endif
+
+            if (currentHttp2Enabled) {
+                configureHttp2(configuredRequest);
+            }
+
+            reply = manager->post(configuredRequest, payload);
+        }
+
+        // Managers on other threads are never in the pool so we only look at managers this server owns.
+        if (manager->parent() == this) {
+            QHash<QNetworkAccessManager*, unsigned long>::iterator it = poolReplyCounts.find(manager);
+            if (it != poolReplyCounts.end()) {
+                ++it.value();
+            }
+        }
+
+        return reply;
+    }
+
+
+    bool Server::setTlsSessionCacheFile(const QString& newFilename) {
+        Q_ASSERT(QThread::currentThread() == thread());
+
+        bool success = false;
+
+        currentTlsSessionCacheFile = newFilename;
+
+        #ifndef QT_NO_SSL
+            currentSslConfiguration = QSslConfiguration::defaultConfiguration();
+            currentSslConfiguration.setSslOption(QSsl::SslOption::SslOptionDisableSessionTickets, false);
+            currentSslConfiguration.setSslOption(QSsl::SslOption::SslOptionDisableSessionPersistence, false);
+
+            currentSessionTicket.clear();
+
+            if (!newFilename.isEmpty()) {
+                QFile file(newFilename);
+                if (file.open(QFile::ReadOnly)) {
+                    currentSessionTicket = file.readAll();
+                    file.close();
+
+                    if (!currentSessionTicket.isEmpty()) {
+                        currentSslConfiguration.setSessionTicket(currentSessionTicket);
+                        success = true;
+                    }
+                }
+            }
+        #endif
+
+        return success;
+    }
+
+
+    const QString& Server::tlsSessionCacheFile() const {
+        return currentTlsSessionCacheFile;
+    }
+
+
+    void Server::startNetworkThread() {
+        if (currentNetworkThread == nullptr) {
+            Q_ASSERT(parent() == nullptr);
+            Q_ASSERT(currentNetworkAccessManager->parent() == nullptr);
+
+            currentNetworkThread = new QThread;
+            currentNetworkThread->setObjectName(QString("RestApiOutV1::Server"));
+            currentNetworkThread->start();
+
+            currentNetworkAccessManager->moveToThread(currentNetworkThread);
+            moveToThread(currentNetworkThread);
+        }
+    }
+
+
+    void Server::stopNetworkThread() {
+        if (currentNetworkThread != nullptr) {
+            QThread* targetThread = QThread::currentThread();
+            Q_ASSERT(targetThread != currentNetworkThread);
+
+            QMetaObject::invokeMethod(
+                this,
+                [this, targetThread]() {
+                    currentNetworkAccessManager->moveToThread(targetThread);
+                    moveToThread(targetThread);
+                },
+                Qt::ConnectionType::BlockingQueuedConnection
+            );
+
+            currentNetworkThread->quit();
+            currentNetworkThread->wait();
+
+            delete currentNetworkThread;
+            currentNetworkThread = nullptr;
+        }
+    }
+
+
+    QThread* Server::networkThread() const {
+        return currentNetworkThread;
+    }
+
+
+    void Server::submit(const Task& task) {
+        submissionQueue.push(task);
+
+        if (!drainScheduled.exchange(true)) {
+            QMetaObject::invokeMethod(
+                this,
+                [this]() {
+                    drainSubmissions();
+                },
+                Qt::ConnectionType::QueuedConnection
+            );
+        }
+    }
+
+
+    Server::Executor Server::queuedExecutor(QObject* context) {
+        return [context](const Task& task) {
+            QMetaObject::invokeMethod(context, task, Qt::ConnectionType::QueuedConnection);
+        };
+    }
+
+
+    void Server::prewarm() {
+        QString host = currentSchemeAndHost.host();
+
+        for (  QList<QNetworkAccessManager*>::const_iterator it  = networkAccessManagerPool.constBegin(),
+                                                             end = networkAccessManagerPool.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            QNetworkAccessManager* manager = *it;
+
+            if (currentSchemeAndHost.scheme() == QString("https")) {
+                #ifndef QT_NO_SSL
+                    // Qt only opens an HTTP/2 connection here if HTTP/2 is listed in the offered ALPN protocols.
+                    QSslConfiguration sslConfiguration = currentTlsSessionCacheFile.isEmpty()
+                                                         ? QSslConfiguration::defaultConfiguration()
+                                                         : currentSslConfiguration;
+
+                    QList<QByteArray> protocols;
+                    if (currentHttp2Enabled) {
+                        protocols.append(QSslConfiguration::ALPNProtocolHTTP2);
+                    }
+
+                    protocols.append(QSslConfiguration::ALPNProtocolHTTP1_1);
+                    sslConfiguration.setAllowedNextProtocols(protocols);
+
+                    manager->connectToHostEncrypted(host, currentSchemeAndHost.port(443), sslConfiguration, QString());
+                #endif
+            } else {
+                manager->connectToHost(host, currentSchemeAndHost.port(80));
+            }
+        }
+    }
+
+
+    void Server::updateTimeDelta(RestApi* restApi) {
+        QMutexLocker locker(&requestMutex);
+
+        if (pendingReply == nullptr) {
+            retriesRemaining = numberRetries;
+            issueTimeDeltaRequest();
+        }
+
+        backgroundRequest = false;
+        timestampUpdatePending.store(true, std::memory_order_release);
+
+        if (!waitingRestApis.contains(restApi)) {
+            waitingRestApis.append(restApi);
+        }
+    }
+
+
+    bool Server::checkTimestamp(RestApi* restApi) {
+        bool result;
+
+        if (!timestampUpdatePending.load(std::memory_order_acquire)) {
+            result = true;
+        } else {
+            QMutexLocker locker(&requestMutex);
+            if (!timestampUpdatePending.load(std::memory_order_relaxed)) {
+                result = true;
+            } else {
+                result = false;
+                if (!waitingRestApis.contains(restApi)) {
+                    waitingRestApis.append(restApi);
+                }
+            }
+        }
+
+        return result;
+    }
+
+
+    void Server::drainSubmissions() {
+        // The flag is cleared before the queue is drained so that a task pushed while we're draining either gets
+        // run here or schedules another drain.
+        drainScheduled.store(false);
+
+        Task task;
+        while (submissionQueue.pop(task)) {
+            task();
+        }
+    }
+
+
+    void Server::processDateHeader(const QNetworkReply* reply, long long latency) {
+        if (currentPassiveTrackingEnabled) {
+            QByteArray dateHeader = reply->rawHeader("Date");
+            if (!dateHeader.isEmpty()) {
+                // The server generated the header, on average, half way through the round trip.
+                long long localTime  = QDateTime::currentMSecsSinceEpoch() - latency / 2;
+                QDateTime serverTime = QDateTime::fromString(
+                    QString::fromLatin1(dateHeader).trimmed(),
+                    Qt::DateFormat::RFC2822Date
+                );
+
+                if (serverTime.isValid()) {
+                    // The Date header is truncated to whole seconds so we assume, on average, the server's clock was
+                    // half a second beyond the reported value.
+                    long long sample  = serverTime.toMSecsSinceEpoch() + 500 - localTime;
+                    bool      updated = false;
+
+                    requestMutex.lock();
+
+                    if (currentPassiveTrackingEnabled && pendingReply == nullptr) {
+                        if (static_cast<unsigned>(passiveSamples.size()) < numberPassiveSamples) {
+                            passiveSamples.append(sample);
+                        } else {
+                            passiveSamples[nextPassiveSampleIndex] = sample;
+                            nextPassiveSampleIndex = (nextPassiveSampleIndex + 1) % numberPassiveSamples;
+                        }
+
+                        if (static_cast<unsigned>(passiveSamples.size()) >= minimumPassiveSamples) {
+                            QList<long long> sorted = passiveSamples;
+                            std::sort(sorted.begin(), sorted.end());
+
+                            long long median = sorted.at(sorted.size() / 2);
+                            if (std::llabs(median - currentTimeDelta.load()) >= passiveTimeDeltaTolerance) {
+                                currentTimeDelta = median;
+                                updated          = true;
+                            }
+                        }
+                    }
+
+                    requestMutex.unlock();
+
+                    if (updated) {
+                        emit timeDeltaChanged();
+                    }
+                }
+            }
+        }
+    }
+
+
+    void Server::recordResponse(const QNetworkReply* reply, long long latency) {
+        QNetworkReply::NetworkError networkError = reply->error();
+
+        // Connection level errors are in the range 1-99 and server side errors are in the range 401-499.  Other
+        // errors are caused by the request itself and say nothing about the health of the server.
+        bool connectionFailure = (
+               networkError >= QNetworkReply::NetworkError::ConnectionRefusedError
+            && networkError <  QNetworkReply::NetworkError::ProxyConnectionRefusedError
+        );
+        bool hostFailure = (
+               connectionFailure
+            || (   networkError >= QNetworkReply::NetworkError::InternalServerError
+                && networkError <= QNetworkReply::NetworkError::UnknownServerError
+               )
+        );
+
+        statisticsMutex.lock();
+
+        if (currentNumberResponses == 0) {
+            currentAverageLatency = static_cast<double>(latency);
+            currentErrorRate      = hostFailure ? 1.0 : 0.0;
         } else {
-            requestMutex.lock();
+            currentAverageLatency += latencyWeight * (static_cast<double>(latency) - currentAverageLatency);
+            currentErrorRate      += errorRateWeight * ((hostFailure ? 1.0 : 0.0) - currentErrorRate);
+        }
 
-            for (  QList<RestApi*>::const_iterator it  = waitingRestApis.constBegin(),
-                                                   end = waitingRestApis.constEnd()
-                 ; it != end
-                 ; ++it
-                ) {
-                (*it)->timestampUpdated();
+        ++currentNumberResponses;
+
+        if (!connectionFailure) {
+            if (static_cast<unsigned>(latencySamples.size()) < numberLatencySamples) {
+                latencySamples.append(latency);
+            } else {
+                latencySamples[nextLatencySampleIndex] = latency;
+                nextLatencySampleIndex = (nextLatencySampleIndex + 1) % numberLatencySamples;
+            }
+        }
+
+        statisticsMutex.unlock();
+
+        if (currentAdaptiveConcurrencyEnabled) {
+            int statusCode = reply->attribute(QNetworkRequest::Attribute::HttpStatusCodeAttribute).toInt();
+            updateConcurrencyLimit(hostFailure || statusCode == 429, latency);
+        }
+
+        processDateHeader(reply, latency);
+    }
+
+
+    void Server::recordAuthenticationFailure(long long signatureMargin) {
+        authenticationFailureCount.fetch_add(1, std::memory_order_relaxed);
+
+        requestMutex.lock();
+        long long uncertainty = timeDeltaEstimator.uncertainty();
+        requestMutex.unlock();
+
+        if (uncertainty < 0) {
+            uncertainty = TimeDeltaEstimator::serverResolution;
+        }
+
+        if (signatureMargin <= uncertainty) {
+            boundaryMissCount.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+
+    void Server::issueScheduled(const Server::Issuer& issuer) {
+        QNetworkReply* reply = issuer();
+        if (reply != nullptr) {
+            inFlightReplies.insert(reply);
+
+            connect(reply, &QNetworkReply::finished, this, [this, reply]() {
+                releaseInFlight(reply);
+            });
+
+            connect(reply, &QObject::destroyed, this, [this, reply]() {
+                releaseInFlight(reply);
+            });
+        }
+    }
+
+
+    void Server::releaseInFlight(QObject* reply) {
+        if (inFlightReplies.remove(reply)) {
+            reply->disconnect(this);
+            dispatchScheduled();
+        }
+    }
+
+
+    void Server::dispatchScheduled() {
+        if (!dispatchingScheduled) {
+            dispatchingScheduled = true;
+
+            bool blocked = false;
+            while (!blocked && !scheduledSources.isEmpty() && inFlightSlotAvailable()) {
+                // We serve the first source, in priority order, whose next request is allowed by the rate limits.
+                QMap<Priority, QList<ScheduledSource>>::iterator classIterator = scheduledSources.begin();
+                QMap<Priority, QList<ScheduledSource>>::iterator classEnd      = scheduledSources.end();
+                int                                              sourceIndex   = 0;
+                long long                                        minimumDelay  = -1;
+                bool                                             found         = false;
+
+                while (!found && classIterator != classEnd) {
+                    const QList<ScheduledSource>& sources = classIterator.value();
+
+                    sourceIndex = 0;
+                    while (!found && sourceIndex < sources.size()) {
+                        const ScheduledRequest& candidate = sources.at(sourceIndex).requests.first();
+                        long long               delay     = rateLimitDelay(candidate.endpoint, candidate.secretKey);
+                        if (delay == 0) {
+                            found = true;
+                        } else {
+                            if (minimumDelay < 0 || delay < minimumDelay) {
+                                minimumDelay = delay;
+                            }
+
+                            ++sourceIndex;
+                        }
+                    }
+
+                    if (!found) {
+                        ++classIterator;
+                    }
+                }
+
+                if (found) {
+                    QList<ScheduledSource>& sources = classIterator.value();
+
+                    // The source that is served is moved to the back of its class so that sources take turns.
+                    ScheduledSource  scheduledSource  = sources.takeAt(sourceIndex);
+                    ScheduledRequest scheduledRequest = scheduledSource.requests.takeFirst();
+
+                    if (!scheduledSource.requests.isEmpty()) {
+                        sources.append(scheduledSource);
+                    }
+
+                    if (sources.isEmpty()) {
+                        scheduledSources.erase(classIterator);
+                    }
+
+                    scheduledTickets.remove(scheduledRequest.ticket);
+                    consumeTokens(scheduledRequest.endpoint, scheduledRequest.secretKey);
+                    issueScheduled(scheduledRequest.issuer);
+                } else {
+                    blocked = true;
+                    startRateLimitTimer(minimumDelay);
+                }
+            }
+
+            dispatchingScheduled = false;
+        }
+    }
+
+
+    double Server::availableTokens(const Server::TokenBucket& bucket, long long now) {
+        return std::min(bucket.capacity, bucket.tokens + bucket.rate * static_cast<double>(now - bucket.lastUpdate));
+    }
+
+
+    long long Server::rateLimitDelay(const QString& endpoint, const QByteArray& secretKey) const {
+        long long result = 0;
+
+        if (!endpointBuckets.isEmpty() || !secretBuckets.isEmpty()) {
+            long long now = rateLimitClock.elapsed();
+
+            QHash<QString, TokenBucket>::const_iterator endpointIterator = endpointBuckets.constFind(endpoint);
+            if (endpointIterator != endpointBuckets.constEnd()) {
+                const TokenBucket& bucket = endpointIterator.value();
+                double             tokens = availableTokens(bucket, now);
+                if (tokens < 1.0) {
+                    result = std::max(result, static_cast<long long>(std::ceil((1.0 - tokens) / bucket.rate)));
+                }
+            }
+
+            const QByteArray& key = secretKey.isEmpty() ? defaultSecretRateKey : secretKey;
+
+            QHash<QByteArray, TokenBucket>::const_iterator secretIterator = secretBuckets.constFind(key);
+            if (secretIterator != secretBuckets.constEnd()) {
+                const TokenBucket& bucket = secretIterator.value();
+                double             tokens = availableTokens(bucket, now);
+                if (tokens < 1.0) {
+                    result = std::max(result, static_cast<long long>(std::ceil((1.0 - tokens) / bucket.rate)));
+                }
+            }
+        }
+
+        return result;
+    }
+
+
+    void Server::consumeTokens(const QString& endpoint, const QByteArray& secretKey) {
+        if (!endpointBuckets.isEmpty() || !secretBuckets.isEmpty()) {
+            long long now = rateLimitClock.elapsed();
+
+            QHash<QString, TokenBucket>::iterator endpointIterator = endpointBuckets.find(endpoint);
+            if (endpointIterator != endpointBuckets.end()) {
+                TokenBucket& bucket = endpointIterator.value();
+                bucket.tokens     = availableTokens(bucket, now) - 1.0;
+                bucket.lastUpdate = now;
+            }
+
+            QHash<QByteArray, TokenBucket>::iterator secretIterator = secretBuckets.find(
+                secretKey.isEmpty() ? defaultSecretRateKey : secretKey
+            );
+            if (secretIterator != secretBuckets.end()) {
+                TokenBucket& bucket = secretIterator.value();
+                bucket.tokens     = availableTokens(bucket, now) - 1.0;
+                bucket.lastUpdate = now;
+            }
+        }
+    }
+
+
+    void Server::startRateLimitTimer(long long delay) {
+        if (delay >= 0 && (!rateLimitTimer.isActive() || rateLimitTimer.remainingTime() > delay)) {
+            rateLimitTimer.start(static_cast<int>(std::min(delay, 0x7FFFFFFFLL)));
+        }
+    }
+
+
+    bool Server::inFlightSlotAvailable() const {
+        unsigned long numberInFlight = static_cast<unsigned long>(inFlightReplies.size());
+        return (
+               (currentMaximumInFlightRequests == 0 || numberInFlight < currentMaximumInFlightRequests)
+            && (!currentAdaptiveConcurrencyEnabled  || numberInFlight < concurrencyLimit())
+        );
+    }
+
+
+    void Server::updateConcurrencyLimit(bool overloaded, long long latency) {
+        if (baselineLatency < 0 || latency < baselineLatency) {
+            baselineLatency = static_cast<double>(latency);
+        } else {
+            baselineLatency += baselineLatencyDriftWeight * (static_cast<double>(latency) - baselineLatency);
+        }
+
+        bool congested = (
+               overloaded
+            || latency > static_cast<long long>(baselineLatency * congestionLatencyRatio) + congestionLatencySlack
+        );
+
+        if (congested) {
+            // Requests sent before the last decrease report the same congestion, so we reduce the limit at most
+            // once per round trip.
+            if (!concurrencyDecreaseTimer.isValid() || concurrencyDecreaseTimer.elapsed() >= latency) {
+                currentConcurrencyLimit = std::max(
+                    static_cast<double>(currentMinimumConcurrencyLimit),
+                    currentConcurrencyLimit * concurrencyDecreaseFactor
+                );
+
+                concurrencyDecreaseTimer.start();
+            }
+        } else if (static_cast<unsigned long>(inFlightReplies.size()) + 1 >= concurrencyLimit()) {
+            // We only grow the limit while it's being used, otherwise an idle period would inflate it without
+            // evidence that the host can cope.
+            currentConcurrencyLimit = std::min(
+                static_cast<double>(currentMaximumConcurrencyLimit),
+                currentConcurrencyLimit + 1.0 / currentConcurrencyLimit
+            );
+        }
+    }
+
+
+    void Server::issueTimeDeltaRequest() {
+        QNetworkRequest request(timeDeltaUrl());
+
+        timeDeltaRequestTimestamp = QDateTime::currentMSecsSinceEpoch();
+
+        QJsonObject jsonObject;
+        jsonObject.insert("timestamp", static_cast<double>(timeDeltaRequestTimestamp / 1000));
+
+        QByteArray message = QJsonDocument(jsonObject).toJson(QJsonDocument::JsonFormat::Compact);
+
+        request.setHeader(QNetworkRequest::KnownHeaders::UserAgentHeader, currentUserAgent);
+        request.setHeader(QNetworkRequest::KnownHeaders::ContentTypeHeader, "application/json");
+        request.setHeader(QNetworkRequest::KnownHeaders::ContentLengthHeader, message.size());
+        request.setRawHeader("Accept", "*/*");
+
+        request.setTransferTimeout();
+
+        configureNetworkAccessManager(currentNetworkAccessManager);
+
+        timeDeltaRequestTimer.start();
+
+        if (currentTransport != nullptr) {
+            pendingReply = currentTransport->post(request, message);
+        } else {
+            pendingReply = post(currentNetworkAccessManager, request, message);
+        }
+
+        pendingReply->setParent(this);
+
+        connect(pendingReply, &QNetworkReply::finished, this, &Server::responseReceived);
+    }
+
+
+    bool Server::http2Applies() const {
+        return currentTransport == nullptr && currentPipelinedHttpClient == nullptr;
+    }
+
+
+    void Server::configureHttp2(QNetworkRequest& request) const {
+        request.setAttribute(QNetworkRequest::Attribute::Http2AllowedAttribute, true);
+
+        if (request.url().scheme() == QString("http")) {
+            request.setAttribute(QNetworkRequest::Attribute::Http2DirectAttribute, true);
+        }
+
+        request.setHttp2Configuration(currentHttp2Configuration);
+    }
+
+
+    bool Server::updateHttp2Configuration() {
+        QHttp2Configuration configuration;
+        bool                success = true;
+
+        if (currentHttp2StreamReceiveWindowSize != 0) {
+            success = configuration.setStreamReceiveWindowSize(currentHttp2StreamReceiveWindowSize) && success;
+        }
+
+        if (currentHttp2SessionReceiveWindowSize != 0) {
+            success = configuration.setSessionReceiveWindowSize(currentHttp2SessionReceiveWindowSize) && success;
+        }
+
+        if (currentHttp2MaximumFrameSize != 0) {
+            success = configuration.setMaxFrameSize(currentHttp2MaximumFrameSize) && success;
+        }
+
+        currentHttp2Configuration = configuration;
+        return success;
+    }
+
+
+    void Server::configureNetworkAccessManager(QNetworkAccessManager* manager) {
+        manager->setRedirectPolicy(QNetworkRequest::RedirectPolicy::NoLessSafeRedirectPolicy);
+        manager->setStrictTransportSecurityEnabled(false);
+    }
+
+
+    QNetworkAccessManager* Server::selectNetworkAccessManager(const QNetworkRequest& request) {
+        QNetworkAccessManager* manager;
+        unsigned               poolSize = static_cast<unsigned>(networkAccessManagerPool.size());
+
+        if (poolSize == 1) {
+            manager = currentNetworkAccessManager;
+        } else if (currentShardingPolicy == ShardingPolicy::BY_ENDPOINT) {
+            manager = networkAccessManagerPool.at(static_cast<int>(qHash(request.url().path()) % poolSize));
+        } else {
+            unsigned index = nextNetworkAccessManagerIndex.fetch_add(1, std::memory_order_relaxed);
+            manager = networkAccessManagerPool.at(static_cast<int>(index % poolSize));
+        }
+
+        return manager;
+    }
+
+
+    void Server::poolReplyFinished(QNetworkAccessManager* manager) {
+        QHash<QNetworkAccessManager*, unsigned long>::iterator it = poolReplyCounts.find(manager);
+        if (it != poolReplyCounts.end()) {
+            if (it.value() > 0) {
+                --it.value();
+            }
+
+            if (it.value() == 0 && !networkAccessManagerPool.contains(manager)) {
+                poolReplyCounts.erase(it);
+                manager->deleteLater();
+            }
+        }
+    }
+
+
+    void Server::responseReceived() {
+        QNetworkReply::NetworkError networkError = pendingReply->error();
+        bool                        success;
+
+        if (networkError == QNetworkReply::NetworkError::NoError) {
+            QByteArray receivedData = pendingReply->readAll();
+
+            QJsonParseError parseError;
+            QJsonDocument   jsonDocument = QJsonDocument::fromJson(receivedData, &parseError);
+            if (parseError.error == QJsonParseError::NoError) {
+                success = parseResponse(jsonDocument);
+            } else {
+                success = false;
+            }
+        } else {
+            success = false;
+        }
+
+        pendingReply->deleteLater();
+
+        if (!success) {
+            if (retriesRemaining > 0) {
+                --retriesRemaining;
+                issueTimeDeltaRequest();
+            } else {
+                requestMutex.lock();
+
+                failingRestApis.append(waitingRestApis);
+                waitingRestApis.clear();
+
+                pendingReply           = nullptr;
+                backgroundRequest      = false;
+                timestampUpdatePending.store(false, std::memory_order_release);
+                requestMutex.unlock();
+
+                // Entries are taken one at a time under the lock so a REST API destroyed by an earlier callback is
+                // removed by removeRestApi() before we reach it.
+                RestApi* restApi;
+                do {
+                    requestMutex.lock();
+                    restApi = failingRestApis.isEmpty() ? nullptr : failingRestApis.takeFirst();
+                    requestMutex.unlock();
+
+                    if (restApi != nullptr) {
+                        restApi->timestampUpdateFailed();
+                    }
+                } while (restApi != nullptr);
+
+                emit timeDeltaUpdateFailed();
             }
+        } else {
+            requestMutex.lock();
 
+            resumingRestApis.append(waitingRestApis);
             waitingRestApis.clear();
 
-            pendingReply = nullptr;
+            pendingReply           = nullptr;
+            backgroundRequest      = false;
+            timestampUpdatePending.store(false, std::memory_order_release);
             requestMutex.unlock();
 
+            if (!resumeTimer.isActive()) {
+                resumeWaitingRestApis();
+            }
+
+            if (!currentTimeDeltaCacheFile.isEmpty()) {
+                saveTimeDeltaCache();
+            }
+
             emit timeDeltaChanged();
         }
+
+        if (pendingReply == nullptr) {
+            scheduleTimeDeltaRefresh();
+        }
+    }
+
+
+    void Server::resumeWaitingRestApis() {
+        RestApi* restApi;
+        unsigned numberResumed = 0;
+        bool     moreRemaining;
+
+        // Entries are taken one at a time under the lock so a REST API destroyed by an earlier callback is removed by
+        // removeRestApi() before we reach it.
+        do {
+            restApi = nullptr;
+
+            requestMutex.lock();
+            bool batchFull = currentResumeBatchSize != 0 && numberResumed >= currentResumeBatchSize;
+            if (!batchFull && !resumingRestApis.isEmpty()) {
+                restApi = resumingRestApis.takeFirst();
+                ++numberResumed;
+            }
+
+            moreRemaining = !resumingRestApis.isEmpty();
+            requestMutex.unlock();
+
+            if (restApi != nullptr) {
+                restApi->timestampUpdated();
+            }
+        } while (restApi != nullptr);
+
+        if (moreRemaining) {
+            resumeTimer.start(static_cast<int>(currentResumeInterval));
+        }
+    }
+
+
+    void Server::removeRestApi(RestApi* restApi) {
+        QMutexLocker locker(&requestMutex);
+
+        waitingRestApis.removeAll(restApi);
+        resumingRestApis.removeAll(restApi);
+        failingRestApis.removeAll(restApi);
     }
 
 
+    #ifndef QT_NO_SSL
+
+        void Server::connectionEncrypted(QNetworkReply* reply) {
+            if (!currentTlsSessionCacheFile.isEmpty()) {
+                QByteArray sessionTicket = reply->sslConfiguration().sessionTicket();
+                if (!sessionTicket.isEmpty() && sessionTicket != currentSessionTicket) {
+                    // New connections must resume with the latest ticket, not the one we loaded at startup, even if
+                    // we can't persist it.
+                    currentSessionTicket = sessionTicket;
+                    currentSslConfiguration.setSessionTicket(sessionTicket);
+
+                    QSaveFile file(currentTlsSessionCacheFile);
+                    if (file.open(QFile::WriteOnly)) {
+                        // The ticket is enough to resume the session so only the owner may read it.
+                        file.setPermissions(QFileDevice::ReadOwner | QFileDevice::WriteOwner);
+                        file.write(sessionTicket);
+                        file.commit();
+                    }
+                }
+            }
+        }
+
+    #endif
+
+
     bool Server::parseResponse(const QJsonDocument& document) {
         static constexpr double timeDeltaMax = (1ULL << std::numeric_limits<double>::digits) - 1;
 
@@ -333,7 +1931,32 @@ namespace RestApiOutV1 {
                 if (statusValue.isString() && timeDeltaValue.isDouble() && statusValue.toString() == "OK") {
                     double timeDelta = timeDeltaValue.toDouble();
                     if (timeDelta >= std::numeric_limits<long long>::lowest() && timeDelta <= timeDeltaMax) {
-                        currentTimeDelta = static_cast<long long>(timeDelta);
+                        long long roundTripTime = timeDeltaRequestTimer.elapsed();
+
+                        // The server measures the delta against the whole second timestamp we sent it, on
+                        // reception of the request.  We correct for the truncated fraction of our timestamp and
+                        // for the transit time to the server.  A whole second response indicates the server also
+                        // truncated its own clock so we assume it was, on average, half way through that second.
+                        long long sentFraction = timeDeltaRequestTimestamp % 1000;
+                        long long resolution   = std::floor(timeDelta) == timeDelta
+                                                 ? TimeDeltaEstimator::serverResolution / 2
+                                                 : 0;
+
+                        long long compensated = static_cast<long long>(std::floor(1000.0 * timeDelta + 0.5))
+                                                + resolution
+                                                - sentFraction
+                                                - roundTripTime / 2;
+
+                        requestMutex.lock();
+                        timeDeltaEstimator.addSample(compensated, roundTripTime);
+                        currentTimeDelta   = timeDeltaEstimator.timeDelta();
+                        currentTransitTime = timeDeltaEstimator.roundTripTime() / 2;
+
+                        // Passive samples gathered before this response describe the clock we just replaced.
+                        passiveSamples.clear();
+                        nextPassiveSampleIndex = 0;
+                        requestMutex.unlock();
+
                         success = true;
                     }
                 }
@@ -342,4 +1965,104 @@ namespace RestApiOutV1 {
 
         return success;
     }
+
+
+    void Server::scheduleTimeDeltaRefresh() {
+        if (currentRefreshInterval > 0) {
+            long long interval = static_cast<long long>(currentRefreshInterval);
+            if (currentRefreshJitter > 0) {
+                unsigned long long range  = 2ULL * currentRefreshJitter + 1;
+                long long          jitter = static_cast<long long>(QRandomGenerator::global()->generate64() % range);
+                interval += jitter - static_cast<long long>(currentRefreshJitter);
+            }
+
+            refreshTimer.start(static_cast<int>(std::max(1000LL, std::min(interval, 0x7FFFFFFFLL))));
+        } else {
+            refreshTimer.stop();
+        }
+    }
+
+
+    bool Server::loadTimeDeltaCache(unsigned long maximumAge) {
+        bool success = false;
+
+        QFile file(currentTimeDeltaCacheFile);
+        if (file.open(QFile::ReadOnly)) {
+            QByteArray data = file.readAll();
+            file.close();
+
+            QJsonParseError parseError;
+            QJsonDocument   jsonDocument = QJsonDocument::fromJson(data, &parseError);
+            if (parseError.error == QJsonParseError::NoError && jsonDocument.isObject()) {
+                QJsonObject jsonObject         = jsonDocument.object();
+                QJsonValue  timeDeltaValue     = jsonObject.value("time_delta");
+                QJsonValue  wallTimeValue      = jsonObject.value("wall_time");
+                QJsonValue  monotonicTimeValue = jsonObject.value("monotonic_time");
+                QJsonValue  bootIdValue        = jsonObject.value("boot_id");
+
+                if (timeDeltaValue.isDouble()     &&
+                    wallTimeValue.isDouble()      &&
+                    monotonicTimeValue.isDouble() &&
+                    bootIdValue.isString()           ) {
+                    long long timeDelta     = static_cast<long long>(timeDeltaValue.toDouble());
+                    long long wallTime      = static_cast<long long>(wallTimeValue.toDouble());
+                    long long monotonicTime = static_cast<long long>(monotonicTimeValue.toDouble());
+                    QString   bootId        = bootIdValue.toString();
+
+                    QElapsedTimer timer;
+                    timer.start();
+
+                    long long currentWallTime      = QDateTime::currentMSecsSinceEpoch();
+                    long long currentMonotonicTime = timer.msecsSinceReference();
+                    QString   currentBootId        = QString::fromLatin1(QSysInfo::bootUniqueId());
+                    long long age;
+
+                    if (!bootId.isEmpty() && bootId == currentBootId && currentMonotonicTime >= monotonicTime) {
+                        // Same boot so the monotonic clock gives us a trustworthy age and any difference between the
+                        // elapsed wall and monotonic time is a step of the local wall clock.
+                        age = currentMonotonicTime - monotonicTime;
+
+                        long long clockStep = (currentWallTime - wallTime) - age;
+                        if (std::llabs(clockStep) > clockStepTolerance) {
+                            timeDelta -= clockStep;
+                        }
+                    } else {
+                        age = currentWallTime - wallTime;
+                    }
+
+                    if (age >= 0 && age <= 1000LL * static_cast<long long>(maximumAge)) {
+                        currentTimeDelta = timeDelta;
+                        success          = true;
+                    }
+                }
+            }
+        }
+
+        return success;
+    }
+
+
+    void Server::saveTimeDeltaCache() {
+        // The estimator is updated under the request mutex so we snapshot the values before writing the file.
+        requestMutex.lock();
+        long long timeDelta   = currentTimeDelta.load();
+        long long uncertainty = timeDeltaEstimator.uncertainty();
+        requestMutex.unlock();
+
+        QElapsedTimer timer;
+        timer.start();
+
+        QJsonObject jsonObject;
+        jsonObject.insert("time_delta", static_cast<double>(timeDelta));
+        jsonObject.insert("uncertainty", static_cast<double>(uncertainty));
+        jsonObject.insert("wall_time", static_cast<double>(QDateTime::currentMSecsSinceEpoch()));
+        jsonObject.insert("monotonic_time", static_cast<double>(timer.msecsSinceReference()));
+        jsonObject.insert("boot_id", QString::fromLatin1(QSysInfo::bootUniqueId()));
+
+        QSaveFile file(currentTimeDeltaCacheFile);
+        if (file.open(QFile::WriteOnly)) {
+            file.write(QJsonDocument(jsonObject).toJson(QJsonDocument::JsonFormat::Compact));
+            file.commit();
+        }
+    }
 }
@@ -0,0 +1,255 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref RestApiOutV1::ServerGroup class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QObject>
+#include <QList>
+#include <QHash>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QRandomGenerator>
+
+#include <algorithm>
+
+#include "rest_api_out_v1_server.h"
+#include "rest_api_out_v1_server_group.h"
+
+namespace RestApiOutV1 {
+    const double             ServerGroup::defaultEjectionErrorRate    = 0.5;
+    const unsigned long      ServerGroup::defaultEjectionDuration     = 30000;
+    const unsigned long long ServerGroup::minimumResponsesForEjection = 5;
+
+    ServerGroup::ServerGroup(QObject* parent):QObject(parent) {
+        currentEjectionErrorRate = defaultEjectionErrorRate;
+        currentEjectionDuration  = defaultEjectionDuration;
+
+        groupTimer.start();
+    }
+
+
+    ServerGroup::~ServerGroup() {}
+
+
+    void ServerGroup::addServer(Server* server) {
+        QMutexLocker locker(&groupMutex);
+
+        if (!currentServers.contains(server)) {
+            currentServers.append(server);
+
+            // Servers can be destroyed while still in the group so we drop them when they go away.
+            connect(server, &QObject::destroyed, this, [this, server]() {
+                removeServer(server);
+            }, Qt::DirectConnection);
+        }
+    }
+
+
+    void ServerGroup::removeServer(Server* server) {
+        QMutexLocker locker(&groupMutex);
+
+        if (currentServers.removeAll(server) > 0) {
+            disconnect(server, &QObject::destroyed, this, nullptr);
+        }
+
+        ejectedUntil.remove(server);
+    }
+
+
+    QList<Server*> ServerGroup::servers() const {
+        QMutexLocker locker(&groupMutex);
+        return currentServers;
+    }
+
+
+    void ServerGroup::setEjectionErrorRate(double newErrorRate) {
+        QMutexLocker locker(&groupMutex);
+        currentEjectionErrorRate = newErrorRate;
+    }
+
+
+    double ServerGroup::ejectionErrorRate() const {
+        QMutexLocker locker(&groupMutex);
+        return currentEjectionErrorRate;
+    }
+
+
+    void ServerGroup::setEjectionDuration(unsigned long newDuration) {
+        QMutexLocker locker(&groupMutex);
+        currentEjectionDuration = newDuration;
+    }
+
+
+    unsigned long ServerGroup::ejectionDuration() const {
+        QMutexLocker locker(&groupMutex);
+        return currentEjectionDuration;
+    }
+
+
+    bool ServerGroup::isEjected(Server* server) const {
+        QMutexLocker locker(&groupMutex);
+        return ejectedUntil.contains(server);
+    }
+
+
+    Server* ServerGroup::selectServer() {
+        Server*        result = nullptr;
+        QList<Server*> ejected;
+        QList<Server*> readmitted;
+
+        groupMutex.lock();
+
+        updateEjections(ejected, readmitted);
+
+        QList<Server*> candidates;
+        for (  QList<Server*>::const_iterator it  = currentServers.constBegin(),
+                                              end = currentServers.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            if (!ejectedUntil.contains(*it)) {
+                candidates.append(*it);
+            }
+        }
+
+        if (candidates.isEmpty()) {
+            // Every server is ejected.  Rather than fail, we use the server that will be re-admitted first.
+            long long earliest = 0;
+            for (  QHash<Server*, long long>::const_iterator it  = ejectedUntil.constBegin(),
+                                                             end = ejectedUntil.constEnd()
+                 ; it != end
+                 ; ++it
+                ) {
+                if (result == nullptr || it.value() < earliest) {
+                    result   = it.key();
+                    earliest = it.value();
+                }
+            }
+        } else if (candidates.size() == 1) {
+            result = candidates.first();
+        } else {
+            unsigned numberCandidates = static_cast<unsigned>(candidates.size());
+            unsigned first            = QRandomGenerator::global()->bounded(numberCandidates);
+            unsigned second           = QRandomGenerator::global()->bounded(numberCandidates - 1);
+
+            if (second >= first) {
+                ++second;
+            }
+
+            Server* firstServer  = candidates.at(static_cast<int>(first));
+            Server* secondServer = candidates.at(static_cast<int>(second));
+
+            result = cost(firstServer) <= cost(secondServer) ? firstServer : secondServer;
+        }
+
+        groupMutex.unlock();
+
+        for (  QList<Server*>::const_iterator it  = ejected.constBegin(),
+                                              end = ejected.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            emit serverEjected(*it);
+        }
+
+        for (  QList<Server*>::const_iterator it  = readmitted.constBegin(),
+                                              end = readmitted.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            emit serverReadmitted(*it);
+        }
+
+        return result;
+    }
+
+
+    double ServerGroup::cost(const Server* server) {
+        double latency   = server->averageLatency();
+        double errorRate = server->errorRate();
+
+        // Servers we have no latency data for are treated as the cheapest so they are probed promptly.
+        return latency < 0 ? 0 : (latency + 1.0) * (1.0 + 10.0 * errorRate);
+    }
+
+
+    double ServerGroup::medianLatency() const {
+        QList<double> latencies;
+        for (  QList<Server*>::const_iterator it  = currentServers.constBegin(),
+                                              end = currentServers.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            if (!ejectedUntil.contains(*it)) {
+                double latency = (*it)->averageLatency();
+                if (latency >= 0) {
+                    latencies.append(latency);
+                }
+            }
+        }
+
+        double result;
+        if (!latencies.isEmpty()) {
+            int index = static_cast<int>(latencies.size()) / 2;
+            std::nth_element(latencies.begin(), latencies.begin() + index, latencies.end());
+            result = latencies.at(index);
+        } else {
+            result = -1;
+        }
+
+        return result;
+    }
+
+
+    void ServerGroup::updateEjections(QList<Server*>& ejected, QList<Server*>& readmitted) {
+        long long now = groupTimer.elapsed();
+
+        for (  QList<Server*>::const_iterator it  = currentServers.constBegin(),
+                                              end = currentServers.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            Server*                             server     = *it;
+            QHash<Server*, long long>::iterator ejectionIt = ejectedUntil.find(server);
+
+            if (ejectionIt != ejectedUntil.end()) {
+                if (now >= ejectionIt.value()) {
+                    // Re-admitted servers start with fresh statistics so they must prove themselves before they can
+                    // be ejected again.  We seed the latency with the group median, or the server's own latency if
+                    // it's alone, so the server isn't treated as the cheapest in the group and flooded with traffic.
+                    double initialLatency = medianLatency();
+                    if (initialLatency < 0) {
+                        initialLatency = server->averageLatency();
+                    }
+
+                    ejectedUntil.erase(ejectionIt);
+                    server->resetStatistics(initialLatency);
+                    readmitted.append(server);
+                }
+            } else if (server->numberResponses() >= minimumResponsesForEjection &&
+                       server->errorRate() > currentEjectionErrorRate              ) {
+                ejectedUntil.insert(server, now + static_cast<long long>(currentEjectionDuration));
+                ejected.append(server);
+            }
+        }
+    }
+}
@@ -0,0 +1,161 @@
+/*-*-c++-*-*************************************************************************************************************
+* Copyright 2016 - 2022 Inesonic, LLC.
+*
+* MIT License:
+*   Permission is hereby granted, free of charge, to any person obtaining a copy of this software and associated
+*   documentation files (the "Software"), to deal in the Software without restriction, including without limitation the
+*   rights to use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software, and to
+*   permit persons to whom the Software is furnished to do so, subject to the following conditions:
+*   
+*   The above copyright notice and this permission notice shall be included in all copies or substantial portions of the
+*   Software.
+*   
+*   THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE
+*   WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS
+*   OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR
+*   OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+********************************************************************************************************************//**
+* \file
+*
+* This file implements the \ref RestApiOutV1::TimeDeltaEstimator class.
+***********************************************************************************************************************/
+
+#include <QtGlobal>
+#include <QList>
+#include <QElapsedTimer>
+
+#include <cstdlib>
+#include <cmath>
+
+#include "rest_api_out_v1_time_delta_estimator.h"
+
+namespace RestApiOutV1 {
+    /**
+     * Allowed drift of the local clock relative to the server's clock, in mSec per mSec.  The value of 100 ppm is
+     * larger than the 15 ppm used by NTP as the local clock may not be disciplined.
+     */
+    static const double maximumDriftRate = 0.0001;
+
+    TimeDeltaEstimator::TimeDeltaEstimator(unsigned numberSamples) {
+        Q_ASSERT(numberSamples > 0);
+
+        maximumNumberSamples = numberSamples;
+        clock.start();
+
+        clear();
+    }
+
+
+    TimeDeltaEstimator::~TimeDeltaEstimator() {}
+
+
+    void TimeDeltaEstimator::addSample(long long timeDelta, long long roundTripTime) {
+        Sample sample;
+        sample.timeDelta     = timeDelta;
+        sample.roundTripTime = roundTripTime >= 0 ? roundTripTime : 0;
+        sample.sampleTime    = clock.elapsed();
+
+        if (!samples.isEmpty()) {
+            // A sample that can not be reconciled with the current estimate indicates that one of the clocks was
+            // stepped.  Older samples are no longer meaningful so we start over.
+            long long bound = uncertainty() + sample.roundTripTime / 2 + serverResolution;
+            if (std::llabs(sample.timeDelta - currentTimeDelta) > bound) {
+                samples.clear();
+                nextSampleIndex = 0;
+            }
+        }
+
+        if (static_cast<unsigned>(samples.size()) < maximumNumberSamples) {
+            samples.append(sample);
+        } else {
+            samples[nextSampleIndex] = sample;
+            nextSampleIndex = (nextSampleIndex + 1) % maximumNumberSamples;
+        }
+
+        update();
+    }
+
+
+    void TimeDeltaEstimator::clear() {
+        samples.clear();
+        nextSampleIndex = 0;
+
+        currentTimeDelta     = 0;
+        currentUncertainty   = -1;
+        currentRoundTripTime = -1;
+        currentSampleTime    = 0;
+    }
+
+
+    bool TimeDeltaEstimator::isValid() const {
+        return !samples.isEmpty();
+    }
+
+
+    bool TimeDeltaEstimator::isInvalid() const {
+        return samples.isEmpty();
+    }
+
+
+    long long TimeDeltaEstimator::timeDelta() const {
+        return currentTimeDelta;
+    }
+
+
+    long long TimeDeltaEstimator::uncertainty() const {
+        return currentUncertainty >= 0 ? currentUncertainty + driftAllowance(currentSampleTime) : currentUncertainty;
+    }
+
+
+    long long TimeDeltaEstimator::roundTripTime() const {
+        return currentRoundTripTime;
+    }
+
+
+    unsigned TimeDeltaEstimator::numberSamples() const {
+        return static_cast<unsigned>(samples.size());
+    }
+
+
+    void TimeDeltaEstimator::update() {
+        // All samples age at the same rate so the ordering by error bound does not change until the next sample is
+        // added.  We can therefore select once here rather than on every query.
+        const Sample* best      = &samples.first();
+        long long     bestBound = best->roundTripTime / 2 + driftAllowance(best->sampleTime);
+        for (  QList<Sample>::const_iterator it  = samples.constBegin(),
+                                             end = samples.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            long long bound = it->roundTripTime / 2 + driftAllowance(it->sampleTime);
+            if (bound < bestBound) {
+                best      = &(*it);
+                bestBound = bound;
+            }
+        }
+
+        // Dispersion is the RMS difference between the selected sample and the other retained samples, in the
+        // spirit of the NTP jitter statistic.
+        double sumSquares = 0;
+        for (  QList<Sample>::const_iterator it  = samples.constBegin(),
+                                             end = samples.constEnd()
+             ; it != end
+             ; ++it
+            ) {
+            double difference = static_cast<double>(it->timeDelta - best->timeDelta);
+            sumSquares += difference * difference;
+        }
+
+        long long dispersion = static_cast<long long>(std::sqrt(sumSquares / samples.size()) + 0.5);
+
+        currentTimeDelta     = best->timeDelta;
+        currentRoundTripTime = best->roundTripTime;
+        currentUncertainty   = best->roundTripTime / 2 + serverResolution / 2 + dispersion;
+        currentSampleTime    = best->sampleTime;
+    }
+
+
+    long long TimeDeltaEstimator::driftAllowance(long long sampleTime) const {
+        return static_cast<long long>(maximumDriftRate * static_cast<double>(clock.elapsed() - sampleTime) + 0.5);
+    }
+}